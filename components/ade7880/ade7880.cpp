@@ -1,8 +1,12 @@
 #include "ade7880.h"
 
+#include <algorithm>
+#include <cmath>
+
 #include "ade7880_reg.h"
 
 #include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
 #include "esphome/core/log.h"
 
 namespace esphome {
@@ -10,12 +14,45 @@ namespace ade7880 {
 
 static const char *const TAG = "ade7880";
 
+// Physical scale of the measurement registers
+static constexpr float CURRENT_SCALE = 1.0f / 100000.0f;  // A per LSB
+static constexpr float VOLTAGE_SCALE = 1.0f / 10000.0f;   // V per LSB
+static constexpr float VOLTAGE_RMS_FULL_SCALE = 3766572.0f;  // xVRMS LSB at full scale input
+static constexpr float POWER_SCALE = 1.0f / 100.0f;       // W, VA per LSB
+static constexpr float PF_SCALE = 1.0f / 0x7FFF;
+static constexpr float PERIOD_CLOCK = 256000.0f;          // Frequency = PERIOD_CLOCK / xPERIOD
+static constexpr float HARMONIC_SCALE = 100.0f / (1 << 21);  // % per LSB, 3.21 format
+static constexpr double ENERGY_SCALE = 24576.0 / 360000000.0;  // Wh per xWATTHR LSB, see read_energy_()
+static constexpr float FPF_SCALE = 1.0f / (1 << 21);         // 3.21 format
+
+// Period of phase A, IPEAK/VPEAK hold the largest sample of all phases (reset value)
+static constexpr uint8_t MMODE_VALUE = MMODE_PERSEL_A | MMODE_PEAKSEL_A | MMODE_PEAKSEL_B | MMODE_PEAKSEL_C;
+
 void IRAM_ATTR HOT ADE7880Store::irq0_int(ADE7880Store *store) {
   ++store->irq0_state;
 }
 
+void IRAM_ATTR HOT ADE7880Store::irq1_int(ADE7880Store *store) {
+  uint8_t head = store->irq1_head;
+  uint8_t next = (head + 1) & (ADE7880_EVENT_QUEUE_SIZE - 1);
+  if(next == store->irq1_tail) {
+    // The edge is still serviced by the STATUS1 read of the queued ones, only its time is lost
+    ++store->irq1_dropped;
+    return;
+  }
+  store->irq1_times[head] = micros();
+  store->irq1_head = next;
+}
+
 void ADE7880::setup() {
   this->reset_watchdog_();
+  this->setup_events_();
+  this->setup_blocks_();
+  this->setup_harmonics_();
+  this->setup_capture_();
+  if(this->restore_energy_) {
+    this->restore_energy_state_();
+  }
 
   this->irq0_pin_->setup();
   this->irq0_pin_->attach_interrupt(ADE7880Store::irq0_int, &this->store_, gpio::INTERRUPT_FALLING_EDGE);
@@ -23,6 +60,9 @@ void ADE7880::setup() {
 
   this->irq1_pin_->setup();
   this->irq1_pin_->pin_mode(gpio::FLAG_INPUT);
+  if(this->mask1_) {
+    this->irq1_pin_->attach_interrupt(ADE7880Store::irq1_int, &this->store_, gpio::INTERRUPT_FALLING_EDGE);
+  }
 
   if(this->reset_pin_ != nullptr) {
     this->reset_pin_->setup();
@@ -30,141 +70,401 @@ void ADE7880::setup() {
   }
 
   this->ade_setup_();
+
+  if(this->statistics_ && this->energy_mode_ == ENERGY_HALF_FULL) {
+    // One sample per second, the other modes take it with the LENERGY service
+    this->set_interval("ade_statistics", 1000, [this]() {
+      this->sample_statistics_();
+    });
+  }
+
+  if(this->integrity_interval_) {
+    this->set_interval("ade_integrity_check", this->integrity_interval_, [this]() {
+      this->check_integrity_(false);
+    });
+  }
 }
 
 void ADE7880::loop() {
-  if(this->store_.irq0_state > 0) {
-    if(this->store_.irq0_state > 1) {
-      ESP_LOGW(TAG, "IRQ0 state overflow");
+  if(this->store_.irq1_head != this->store_.irq1_tail || this->irq1_retrigger_) {
+    this->service_irq1_();
+  }
+
+  if(this->store_.irq0_state > 0 && this->service_irq0_()) {
+    // Reset watchdog
+    this->reset_watchdog_();
+  }
+  else if(millis() > this->watchdog_) {
+    ESP_LOGE(TAG, "Watchdog triggered");
+    this->block_index_ = ADE7880_BLOCK_COUNT;
+    // Most trips are bus glitches, a chip that kept its configuration resumes without a reset
+    this->setup_state_ = this->checksum_.checksum ? WARM_BEGIN : 0;
+    this->ade_setup_();
+    return;
+  }
+
+  if(this->block_index_ < ADE7880_BLOCK_COUNT) {
+    this->publish_slice_();
+  }
+  else if(this->group_count_ > 1 && (this->setup_state_ & INIT_DONE) && this->store_.skip_cycles == 0) {
+    uint8_t groups = this->pending_groups_ | this->take_due_groups_(this->pending_groups_);
+    if(groups) {
+      this->start_pass_(groups);
     }
-    // Reset IRQ0 counter to detect interrupt overflow
-    this->store_.irq0_state = 0;
+  }
 
-    int32_t val;
-    i2c::ErrorCode err = this->ade_read_(ADE7880_STATUS0, (uint32_t*)&val);
-    if(err != i2c::ERROR_OK) {
-      ESP_LOGE(TAG, "Failed to read STATUS0 register");
+  if(this->capture_log_ && this->capture_logged_ < this->capture_count_ && !this->capturing_) {
+    this->log_capture_();
+  }
+}
+
+bool ADE7880::service_irq0_() {
+  // DREADY edges arrive at 8 kHz during a waveform capture, only one per service is needed
+  if(this->store_.irq0_state > 1 && !this->capturing_) {
+    if(this->energy_mode_ == ENERGY_LINE_CYCLE) {
+      ESP_LOGW(TAG, "IRQ0 state overflow, line cycle energy lost");
     }
-    if(!(val & STATUS0_LENERGY)) {
-      ESP_LOGE(TAG, "Unexpected ISR0 0x%08X", val);
-      return;
+    else {
+      ESP_LOGD(TAG, "IRQ0 state overflow");
     }
+  }
+  // Reset IRQ0 counter to detect interrupt overflow
+  this->store_.irq0_state = 0;
 
-    this->ade_write_verify_(ADE7880_STATUS0, STATUS0_LENERGY);
-    this->ade_read_verify_(ADE7880_STATUS0, (uint32_t*)&val);
+  uint32_t val;
+  uint32_t phsign;
+  // Waveform samples ride along with STATUS0 and are kept when DREADY is set
+  uint32_t samples[ADE7880_WAVEFORM_CHANNELS];
+  bool capturing = this->capturing_;
+  uint32_t time = micros();
+  i2c::ErrorCode err;
+  if(this->direction_mask0_ || capturing) {
+    this->ade_queue_read_(ADE7880_STATUS0, &val, 1);
+    if(this->direction_mask0_) {
+      // Sign changes are flagged in STATUS0, the signs themselves are in PHSIGN
+      this->ade_queue_read_(ADE7880_PHSIGN, &phsign, 1);
+    }
+    if(capturing) {
+      this->ade_queue_read_(ADE7880_IAWV + this->capture_regs_[0], samples, this->capture_span_);
+    }
+    err = this->ade_commit_();
+  }
+  else {
+    err = this->ade_read_(ADE7880_STATUS0, &val);
+  }
+  if(err != i2c::ERROR_OK) {
+    ESP_LOGE(TAG, "Failed to read STATUS0 register");
+    return false;
+  }
+  uint32_t energy_flag = STATUS0_LENERGY;
+  if(this->energy_mode_ == ENERGY_HALF_FULL) {
+    energy_flag = STATUS0_AEHF;
+    if(this->reactive_energy_enabled_) {
+      energy_flag |= STATUS0_FREHF;
+    }
+  }
+  uint32_t handled = val & (energy_flag | STATUS0_HREADY | this->reverse_mask0_ | (capturing ? STATUS0_DREADY : 0));
+  if(!handled) {
+    ESP_LOGE(TAG, "Unexpected ISR0 0x%08X", val);
+    return false;
+  }
+  if(this->direction_mask0_) {
+    // Published on every service, the sensors only forward changes
+    this->publish_direction_(phsign);
+  }
+  if(handled & STATUS0_DREADY) {
+    this->store_capture_(samples, time);
+  }
 
-    // Allow calibration stabilization
-    if(store_.skip_cycles > 0) {
-      --store_.skip_cycles;
-      return;
+  // Clearing the interrupts and reading the energy registers share one transaction
+  this->ade_queue_write_(ADE7880_STATUS0, handled);
+  bool energy_ok = false;
+  if(handled & energy_flag) {
+    energy_ok = this->service_energy_();
+  }
+  else if((handled & this->energy_sign_mask0_) && this->store_.skip_cycles == 0) {
+    // Collect the energy up to the sign change, so it is split by the direction it flowed in.
+    // Line cycle mode only latches the registers with LENERGY and leaves the mask empty.
+    energy_ok = this->read_energy_();
+  }
+  else {
+    this->ade_commit_();
+  }
+  if(handled & STATUS0_HREADY) {
+    this->service_harmonics_();
+  }
+
+  // IRQ0 stays low without a new edge if another flag was raised after STATUS0 was read
+  if(!this->irq0_pin_->digital_read() && this->store_.irq0_state == 0) {
+    this->store_.irq0_state = 1;
+  }
+  return energy_ok;
+}
+
+void ADE7880::service_irq1_() {
+  // IRQ1 stays low until STATUS1 is cleared, so each queued edge follows a clear and is
+  // serviced on its own. Its time dates the events of this STATUS1 read, a retrigger
+  // without an edge uses the time of the service.
+  uint32_t time = micros();
+  uint8_t tail = this->store_.irq1_tail;
+  if(tail != this->store_.irq1_head) {
+    time = this->store_.irq1_times[tail];
+    this->store_.irq1_tail = (tail + 1) & (ADE7880_EVENT_QUEUE_SIZE - 1);
+  }
+  this->irq1_retrigger_ = false;
+  uint8_t dropped = this->store_.irq1_dropped;
+  if(dropped != this->irq1_dropped_) {
+    ESP_LOGW(TAG, "IRQ1 queue overflow, %u edges without timestamp", (uint8_t)(dropped - this->irq1_dropped_));
+    this->irq1_dropped_ = dropped;
+  }
+  if(!(this->setup_state_ & INIT_DONE)) {
+    // RSTDONE holds IRQ1 low during a reset until ade_init_() clears it
+    return;
+  }
+
+  // IPEAK, VPEAK, STATUS0 and STATUS1 are adjacent, peak events are read in the same burst
+  uint32_t status[4];
+  uint32_t phstatus;
+  if(this->mask1_ & (MASK1_PKI | MASK1_PKV)) {
+    this->ade_queue_read_(ADE7880_IPEAK, status, 4);
+  }
+  else {
+    this->ade_queue_read_(ADE7880_STATUS1, &status[3], 1);
+  }
+  this->ade_queue_read_(ADE7880_PHSTATUS, &phstatus, 1);
+  i2c::ErrorCode err = this->ade_commit_();
+  if(err == i2c::ERROR_OK) {
+    err = this->ade_verify_batch_();
+  }
+  if(err != i2c::ERROR_OK) {
+    ESP_LOGE(TAG, "Failed to read STATUS1 register");
+    return;
+  }
+  uint32_t handled = status[3] & this->mask1_;
+  if(!handled) {
+    ESP_LOGE(TAG, "Unexpected ISR1 0x%08X", status[3]);
+    return;
+  }
+  // A lost phase waits for its next voltage zero crossing, a sequence error is reported once
+  // per update. Flags enabled here are cleared first, they may be stale.
+  uint32_t mask1 = this->mask1_;
+  for(uint8_t i=0; i<3; i++) {
+    if(handled & (STATUS1_ZXVA << i)) {
+      mask1 &= ~(MASK1_ZXVA << i);
     }
+    else if(handled & (STATUS1_ZXTOVA << i)) {
+      mask1 |= MASK1_ZXVA << i;
+    }
+  }
+  mask1 &= ~(handled & (MASK1_SEQERR | MASK1_MISMTCH));
+  // PHSTATUS is cleared together with the STATUS1 bits
+  this->ade_queue_write_(ADE7880_STATUS1, handled | (mask1 & ~this->mask1_));
+  if(mask1 != this->mask1_) {
+    this->ade_queue_write_(ADE7880_MASK1, mask1);
+  }
+  if(this->ade_commit_() != i2c::ERROR_OK) {
+    // The flags are still set, the retry sees them again. Toggled states like sag must
+    // not change twice for one event.
+    ESP_LOGE(TAG, "Failed to clear STATUS1 register");
+    this->irq1_retrigger_ = true;
+    return;
+  }
+  this->mask1_ = mask1;
 
-    // Update active energy delta values
-    // f_s = 1.024 MHz
-    // multiplier = 16
-    // WTHR = 3
-    // scale = 2^7
-    // t = 1 s
-    // (f_s * multiplier * xWATT) / (WTHR * scale) = xWATTHR
-    // xWATT = xWATTHR  * (WTHR * scale) / (f_s * multiplier)
-    // xWATT = xWATTHR * (3 * 2^27) / (1024000 * 16)
-    // xWATT = xWATTHR * 402653184 / 16384000
-    // xWATT = xWATTHR * 24576 / 1000 = xWATTHR * 24576 * 10^-3
-    // duwh = xWATT(10^2 W) * t(s) * 10^4(duWh) / 1(Wh)
-    // duwh = xWATT / 10^2(W) * t(s) / 3600(s/h) * 10^4(duWh) / 1(Wh)
-    // duwh = xWATT * 10^-2(W) * 1(s) / 3600(s/h) * 10^4(duWh) / 1(Wh)
-    // duwh = xWATT * 10^2 / 3600 duWh = xWATT * 10 / 36 duWh
-    // duwh = xWATTHR * 24576 * 10^-3 * 10 / 36
-    // duwh = xWATTHR * 24576 / 3600
-    int32_t duwh_val;
-    bool read_error = false;
-
-    if(this->channel_a_ != nullptr) {
-      err = this->ade_read_verify_(ADE7880_AWATTHR, (uint32_t*)&val);
-      if(err == i2c::ERROR_OK) {
-        duwh_val = val * 24576 / 3600;
-        this->channel_a_->duwh_delta_ += duwh_val;
-
-        if(abs(this->channel_a_->duwh_delta_) > 1000) {
-          int32_t delta = this->channel_a_->duwh_delta_ / 1000;
-          this->channel_a_->duwh_delta_ -= delta * 1000;
-          this->channel_a_->dmwh_ += delta;
-          if(delta > 0) {
-            this->channel_a_->dmwh_forward_ += delta;
-          }
-          else {
-            this->channel_a_->dmwh_reverse_ -= delta;
-          }
+  PowerChannel *channels[3] = {this->channel_a_, this->channel_b_, this->channel_c_};
+  for(uint8_t i=0; i<3; i++) {
+    PowerChannel *channel = channels[i];
+    if(channel == nullptr) {
+      continue;
+    }
+    if((handled & STATUS1_SAG) && (phstatus & (PHSTATUS_VSPHASE_A << i))) {
+      channel->in_sag_ = !channel->in_sag_;
+      if(channel->in_sag_) {
+        channel->sag_start_ = time;
+        ++channel->sag_count_;
+        if(channel->sag_events != nullptr) {
+          channel->sag_events->publish_state(channel->sag_count_);
         }
+        this->publish_event_("sag start", i, time);
       }
       else {
-        ESP_LOGE(TAG, "Failed to read AWATTHR register");
-        read_error = true;
+        char detail[16];
+        snprintf(detail, sizeof(detail), "%u ms", (unsigned)((time - channel->sag_start_) / 1000));
+        this->publish_event_("sag end", i, time, detail);
       }
     }
-
-    if(this->channel_b_ != nullptr) {
-      err = this->ade_read_verify_(ADE7880_BWATTHR, (uint32_t*)&val);
-      if(err == i2c::ERROR_OK) {
-        duwh_val = val * 24576 / 3600;
-        this->channel_b_->duwh_delta_ += duwh_val;
-
-        if(abs(this->channel_b_->duwh_delta_) > 1000) {
-          int32_t delta = this->channel_b_->duwh_delta_ / 1000;
-          this->channel_b_->duwh_delta_ -= delta * 1000;
-          this->channel_b_->dmwh_ += delta;
-          if(delta > 0) {
-            this->channel_b_->dmwh_forward_ += delta;
-          }
-          else {
-            this->channel_b_->dmwh_reverse_ -= delta;
-          }
-        }
-      }
-      else {
-        ESP_LOGE(TAG, "Failed to read BWATTHR register");
-        read_error = true;
+    if((handled & STATUS1_OV) && (phstatus & (PHSTATUS_OVPHASE_A << i))) {
+      ++channel->overvoltage_count_;
+      if(channel->overvoltage_events != nullptr) {
+        channel->overvoltage_events->publish_state(channel->overvoltage_count_);
       }
+      this->publish_event_("overvoltage", i, time);
     }
-
-    if(this->channel_c_ != nullptr) {
-      err = this->ade_read_verify_(ADE7880_CWATTHR, (uint32_t*)&val);
-      if(err == i2c::ERROR_OK) {
-        duwh_val = val * 24576 / 3600;
-        this->channel_c_->duwh_delta_ += duwh_val;
-
-        if(abs(this->channel_c_->duwh_delta_) > 1000) {
-          int32_t delta = this->channel_c_->duwh_delta_ / 1000;
-          this->channel_c_->duwh_delta_ -= delta * 1000;
-          this->channel_c_->dmwh_ += delta;
-          if(delta > 0) {
-            this->channel_c_->dmwh_forward_ += delta;
-          }
-          else {
-            this->channel_c_->dmwh_reverse_ -= delta;
-          }
-        }
+    if((handled & STATUS1_OI) && (phstatus & (PHSTATUS_OIPHASE_A << i))) {
+      ++channel->overcurrent_count_;
+      if(channel->overcurrent_events != nullptr) {
+        channel->overcurrent_events->publish_state(channel->overcurrent_count_);
       }
-      else {
-        ESP_LOGE(TAG, "Failed to read CWATTHR register");
-        read_error = true;
+      this->publish_event_("overcurrent", i, time);
+    }
+    if(handled & ((STATUS1_ZXTOVA | STATUS1_ZXVA) << i)) {
+      channel->phase_lost_ = !(handled & (STATUS1_ZXVA << i));
+      if(channel->phase_loss != nullptr) {
+        channel->phase_loss->publish_state(channel->phase_lost_);
       }
+      this->publish_event_(channel->phase_lost_ ? "phase lost" : "phase restored", i, time);
+    }
+  }
+  if(handled & STATUS1_SEQERR) {
+    if(this->sequence_error_sensor_ != nullptr) {
+      this->sequence_error_sensor_->publish_state(true);
     }
+    this->publish_event_("sequence error", 0, time, "followed by C");
+  }
+  if(handled & STATUS1_MISMTCH) {
+    if(this->channel_n_->current_mismatch != nullptr) {
+      this->channel_n_->current_mismatch->publish_state(true);
+    }
+    this->publish_event_("current mismatch", 3, time);
+  }
 
-    if(!read_error) {
-      // Reset watchdog
-      this->reset_watchdog_();
-      return;
+  // Peak values of all phases over PEAKCYC half line cycles
+  static const uint32_t PEAK_PHASES[3] = {PEAK_PHASE_A, PEAK_PHASE_B, PEAK_PHASE_C};
+  for(uint8_t n=0; n<2 && this->peak_cycles_ > 0; n++) {
+    if(!(handled & (n == 0 ? STATUS1_PKI : STATUS1_PKV))) {
+      continue;
+    }
+    uint8_t phase = 0;
+    while(phase < 2 && !(status[n] & PEAK_PHASES[phase])) {
+      ++phase;
     }
+    char detail[16];
+    float peak = (status[n] & PEAK_VALUE) * (n == 0 ? CURRENT_SCALE : VOLTAGE_SCALE);
+    snprintf(detail, sizeof(detail), n == 0 ? "%.2f A" : "%.1f V", peak);
+    this->publish_event_(n == 0 ? "peak current" : "peak voltage", phase, time, detail);
+  }
+  if(this->peaks_enabled_ && (handled & STATUS1_PKI)) {
+    this->record_peaks_(status[0], status[1]);
   }
 
-  if(millis() > this->watchdog_) {
-    ESP_LOGE(TAG, "Watchdog triggered");
-    this->setup_state_ = 0;
-    this->ade_setup_();
+  // IRQ1 stays low without a new edge if another flag was raised after STATUS1 was read
+  if(!this->irq1_pin_->digital_read() && this->store_.irq1_head == this->store_.irq1_tail) {
+    this->irq1_retrigger_ = true;
+  }
+}
+
+bool ADE7880::service_energy_() {
+  // Allow calibration stabilization
+  if(store_.skip_cycles > 0) {
+    --store_.skip_cycles;
+    this->ade_commit_();
+    return false;
+  }
+
+  // LENERGY comes once a second, the statistics samples ride on its transaction. Energy reads
+  // at sign changes and AEHF don't take them, they would bias the window.
+  uint32_t rms[6];
+  uint32_t watt[3];
+  uint8_t count = 0;
+  if(this->energy_mode_ != ENERGY_HALF_FULL) {
+    count = this->queue_statistics_(rms, watt);
+  }
+  if(!this->read_energy_()) {
+    return false;
+  }
+  this->record_statistics_(count, rms, watt);
+  return true;
+}
+
+static void accumulate_energy(int32_t delta, uint64_t &forward, uint64_t &reverse) {
+  if(delta > 0) {
+    forward += delta;
+  }
+  else {
+    reverse += -(int64_t)delta;
   }
 }
 
+bool ADE7880::read_energy_() {
+  // Accumulate active energy in xWATTHR LSB, the conversion to Wh happens on publish.
+  // xFVARHR share the constants, the same scale gives VARh.
+  // f_s = 1.024 MHz
+  // multiplier = 16
+  // WTHR = 3
+  // scale = 2^7
+  // t = 1 s
+  // (f_s * multiplier * xWATT) / (WTHR * scale) = xWATTHR
+  // xWATT = xWATTHR  * (WTHR * scale) / (f_s * multiplier)
+  // xWATT = xWATTHR * (3 * 2^27) / (1024000 * 16)
+  // xWATT = xWATTHR * 402653184 / 16384000
+  // xWATT = xWATTHR * 24576 / 1000 = xWATTHR * 24576 * 10^-3
+  // duwh = xWATT(10^2 W) * t(s) * 10^4(duWh) / 1(Wh)
+  // duwh = xWATT / 10^2(W) * t(s) / 3600(s/h) * 10^4(duWh) / 1(Wh)
+  // duwh = xWATT * 10^-2(W) * 1(s) / 3600(s/h) * 10^4(duWh) / 1(Wh)
+  // duwh = xWATT * 10^2 / 3600 duWh = xWATT / 36 duWh
+  // duwh = xWATTHR * 24576 * 10^-3 / 36
+  // duwh = xWATTHR * 24576 / 36000
+  // Wh = duwh * 10^-4 = xWATTHR * 24576 / 360000000
+  PowerChannel *channels[3] = {this->channel_a_, this->channel_b_, this->channel_c_};
+  uint8_t count = 3;
+  while(count > 0 && channels[count - 1] == nullptr) {
+    --count;
+  }
+
+  // AWATTHR..CWATTHR (0xE400-0xE402) in one burst, committed only after verification.
+  // AFVARHR..CFVARHR (0xE409-0xE40B) take a second one, 0xE406-0xE408 are reserved.
+  uint32_t energy[3];
+  uint32_t reactive[3];
+  bool read_error = false;
+  if(count > 0) {
+    this->ade_queue_read_(ADE7880_AWATTHR, energy, count);
+    if(this->reactive_energy_enabled_) {
+      this->ade_queue_read_(ADE7880_AFVARHR, reactive, count);
+    }
+  }
+  i2c::ErrorCode err = this->ade_commit_();
+  if(err == i2c::ERROR_OK) {
+    err = this->ade_verify_batch_();
+  }
+  if(err != i2c::ERROR_OK) {
+    ESP_LOGE(TAG, "Failed to read energy registers");
+    read_error = true;
+  }
+
+  for(uint8_t i=0; i<count && !read_error; i++) {
+    PowerChannel *channel = channels[i];
+    if(channel == nullptr) {
+      continue;
+    }
+    uint32_t watthr = energy[i];
+    uint32_t varhr = this->reactive_energy_enabled_ ? reactive[i] : 0;
+    int32_t watthr_val = (int32_t)watthr;
+    int32_t varhr_val = (int32_t)varhr;
+    if(this->energy_mode_ == ENERGY_RUNNING_TOTAL) {
+      // Registers hold running totals, the delta covers every cycle since the last successful read
+      if(!channel->watthr_primed_) {
+        channel->watthr_total_ = watthr;
+        channel->varhr_total_ = varhr;
+        channel->watthr_primed_ = true;
+        continue;
+      }
+      watthr_val = (int32_t)(watthr - channel->watthr_total_);
+      varhr_val = (int32_t)(varhr - channel->varhr_total_);
+      channel->watthr_total_ = watthr;
+      channel->varhr_total_ = varhr;
+    }
+    else if(this->energy_mode_ == ENERGY_HALF_FULL && !channel->watthr_primed_) {
+      // Read-with-reset, discard the energy accumulated during calibration stabilization
+      channel->watthr_primed_ = true;
+      continue;
+    }
+    accumulate_energy(watthr_val, channel->watthr_forward_, channel->watthr_reverse_);
+    accumulate_energy(varhr_val, channel->varhr_forward_, channel->varhr_reverse_);
+  }
+
+  return !read_error;
+}
+
 void ADE7880::update() {
   if(!(this->setup_state_ & INIT_DONE)) {
     // Skip if not initialized
@@ -176,60 +476,76 @@ void ADE7880::update() {
     return;
   }
 
-  int32_t val;
-
-  // TODO: call multiple times with setTimeout to avoid blocking too long
-  if(this->channel_n_ != nullptr) {
-    this->publish_sensor(this->channel_n_->current, ADE7880_NIRMS, 100000.0f);
+  // The bus work done here isn't split by the slice budget, it counts as one slice of the pass
+  // so max_slice_duration reports the real worst case
+  uint32_t start = micros();
+  if(this->mask1_ && !this->irq1_pin_->digital_read()) {
+    // A failed STATUS1 service leaves IRQ1 low without further edges
+    this->irq1_retrigger_ = true;
   }
+  this->rearm_events_();
 
-  if(this->channel_a_ != nullptr) {
-    this->publish_sensor(this->channel_a_->voltage, ADE7880_AVRMS, 10000.0f);
-    this->publish_sensor(this->channel_a_->current, ADE7880_AIRMS, 100000.0f);
-    this->publish_sensor(this->channel_a_->active_power, ADE7880_AWATT, 100.0f);
-    this->publish_sensor(this->channel_a_->apparent_power, ADE7880_AVA, 100.0f);
-    // TODO: reactive power
-    this->publish_sensor(this->channel_a_->power_factor, ADE7880_APF, (float)0x7FFF);
-    this->publish_sensor(this->channel_a_->frequency, ADE7880_APERIOD, 1 / 256000.0f);
+  if(this->block_index_ < ADE7880_BLOCK_COUNT && (this->pass_groups_ & 1)) {
+    ESP_LOGW(TAG, "Previous update still in progress");
+    this->record_slice_(start);
+    return;
+  }
+  if(this->no_load_level_ > 0.0f) {
+    this->update_no_load_();
+  }
+  // Measurement blocks are read and published from loop() in time-bounded slices, a pass of
+  // sensors with their own update_interval is finished first
+  if(this->block_index_ < ADE7880_BLOCK_COUNT) {
+    this->pending_groups_ |= 1;
+  }
+  else {
+    this->start_pass_(1 | this->take_due_groups_(true));
+  }
 
-    if(this->channel_a_->forward_active_energy != nullptr) {
-      this->channel_a_->forward_active_energy->publish_state((float)this->channel_a_->dmwh_forward_ / 100.0f);
-    }
-    if(this->channel_a_->reverse_active_energy != nullptr) {
-      this->channel_a_->reverse_active_energy->publish_state((float)this->channel_a_->dmwh_reverse_ / 100.0f);
+  if(this->energy_mode_ == ENERGY_HALF_FULL) {
+    // AEHF only fires near overflow, collect the energy at update rate. xWATTHR are
+    // read-with-reset so the energy of a failed read is lost.
+    if(this->read_energy_()) {
+      this->reset_watchdog_();
     }
   }
-  if(this->channel_b_ != nullptr) {
-    this->publish_sensor(this->channel_b_->voltage, ADE7880_BVRMS, 10000.0f);
-    this->publish_sensor(this->channel_b_->current, ADE7880_BIRMS, 100000.0f);
-    this->publish_sensor(this->channel_b_->active_power, ADE7880_BWATT, 100.0f);
-    this->publish_sensor(this->channel_b_->apparent_power, ADE7880_BVA, 100.0f);
-    // TODO: reactive power
-    this->publish_sensor(this->channel_b_->power_factor, ADE7880_BPF, (float)0x7FFF);
-    this->publish_sensor(this->channel_b_->frequency, ADE7880_BPERIOD, 1 / 256000.0f);
 
-    if(this->channel_b_->forward_active_energy != nullptr) {
-      this->channel_b_->forward_active_energy->publish_state((float)this->channel_b_->dmwh_forward_ / 100.0f);
-    }
-    if(this->channel_b_->reverse_active_energy != nullptr) {
-      this->channel_b_->reverse_active_energy->publish_state((float)this->channel_b_->dmwh_reverse_ / 100.0f);
-    }
+  if(this->harmonic_groups_ > 0) {
+    this->publish_spectrum_();
+    this->start_harmonics_();
   }
-  if(this->channel_c_ != nullptr) {
-    this->publish_sensor(this->channel_c_->voltage, ADE7880_CVRMS, 10000.0f);
-    this->publish_sensor(this->channel_c_->current, ADE7880_CIRMS, 100000.0f);
-    this->publish_sensor(this->channel_c_->active_power, ADE7880_CWATT, 100.0f);
-    this->publish_sensor(this->channel_c_->apparent_power, ADE7880_CVA, 100.0f);
-    // TODO: reactive power
-    this->publish_sensor(this->channel_c_->power_factor, ADE7880_CPF, (float)0x7FFF);
-    this->publish_sensor(this->channel_c_->frequency, ADE7880_CPERIOD, 1 / 256000.0f);
 
-    if(this->channel_c_->forward_active_energy != nullptr) {
-      this->channel_c_->forward_active_energy->publish_state((float)this->channel_c_->dmwh_forward_ / 100.0f);
+  PowerChannel *channels[3] = {this->channel_a_, this->channel_b_, this->channel_c_};
+  for(PowerChannel *channel : channels) {
+    if(channel == nullptr) {
+      continue;
+    }
+    if(channel->forward_active_energy != nullptr) {
+      channel->forward_active_energy->publish_state((float)(channel->watthr_forward_ * ENERGY_SCALE));
+    }
+    if(channel->reverse_active_energy != nullptr) {
+      channel->reverse_active_energy->publish_state((float)(channel->watthr_reverse_ * ENERGY_SCALE));
     }
-    if(this->channel_c_->reverse_active_energy != nullptr) {
-      this->channel_c_->reverse_active_energy->publish_state((float)this->channel_c_->dmwh_reverse_ / 100.0f);
+    if(channel->forward_reactive_energy != nullptr) {
+      channel->forward_reactive_energy->publish_state((float)(channel->varhr_forward_ * ENERGY_SCALE));
     }
+    if(channel->reverse_reactive_energy != nullptr) {
+      channel->reverse_reactive_energy->publish_state((float)(channel->varhr_reverse_ * ENERGY_SCALE));
+    }
+  }
+
+  if(this->statistics_) {
+    this->publish_statistics_();
+  }
+
+  this->flush_energy_(false);
+  this->record_slice_(start);
+}
+
+void ADE7880::on_shutdown() {
+  if(this->restore_energy_ && this->flush_on_shutdown_) {
+    // Only saved, the preferences component syncs to flash in its own on_shutdown()
+    this->flush_energy_(true);
   }
 }
 
@@ -239,6 +555,73 @@ void ADE7880::dump_config() {
   LOG_PIN("  IRQ1 Pin: ", this->irq1_pin_);
   LOG_PIN("  Reset Pin: ", this->reset_pin_);
   ESP_LOGCONFIG(TAG, "  Frequency: %.0f Hz", this->frequency_);
+  ESP_LOGCONFIG(TAG, "  Slice budget: %u us", this->slice_budget_);
+  for(uint8_t g=1; g<this->group_count_; g++) {
+    ESP_LOGCONFIG(TAG, "  Sensor update interval: %u ms", this->group_intervals_[g]);
+  }
+  switch(this->energy_mode_) {
+    case ENERGY_LINE_CYCLE:
+      ESP_LOGCONFIG(TAG, "  Energy mode: line cycle");
+      break;
+    case ENERGY_RUNNING_TOTAL:
+      ESP_LOGCONFIG(TAG, "  Energy mode: running total");
+      break;
+    case ENERGY_HALF_FULL:
+      ESP_LOGCONFIG(TAG, "  Energy mode: half full");
+      break;
+  }
+  LOG_SENSOR("  ", "Max Slice Duration", this->slice_duration_sensor_);
+  if(this->harmonic_groups_ > 0) {
+    ESP_LOGCONFIG(TAG, "  Harmonic sweep: %u indexes, %u steps per update", (unsigned) this->sweep_indexes_.size(),
+                  this->harmonic_steps_per_update_);
+  }
+  if(this->mask1_) {
+    ESP_LOGCONFIG(TAG, "  Power Quality:");
+    if(this->mask1_ & MASK1_SAG) {
+      ESP_LOGCONFIG(TAG, "    Sag Level: %.1f V over %u half cycles", this->sag_level_, this->sag_cycles_);
+    }
+    if(this->mask1_ & MASK1_OV) {
+      ESP_LOGCONFIG(TAG, "    Overvoltage Level: %.1f V", this->overvoltage_level_);
+    }
+    if(this->mask1_ & MASK1_OI) {
+      ESP_LOGCONFIG(TAG, "    Overcurrent Level: %.2f A", this->overcurrent_level_);
+    }
+    if(this->mask1_ & MASK1_PKI) {
+      ESP_LOGCONFIG(TAG, "    Peak Cycles: %u", this->peak_cycles_);
+    }
+    if(this->mask1_ & (MASK1_ZXTOVA | MASK1_ZXTOVB | MASK1_ZXTOVC)) {
+      ESP_LOGCONFIG(TAG, "    Zero Crossing Timeout: %u ms", this->zero_crossing_timeout_);
+    }
+    LOG_TEXT_SENSOR("    ", "Event", this->event_sensor_);
+    LOG_BINARY_SENSOR("    ", "Phase Sequence Error", this->sequence_error_sensor_);
+  }
+  LOG_BINARY_SENSOR("  ", "Total Reverse Power", this->total_reverse_power_sensor_);
+  if(this->no_load_level_ > 0.0f) {
+    ESP_LOGCONFIG(TAG, "  No Load Level: %.1f VA", this->no_load_level_);
+  }
+  if(!this->capture_values_.empty()) {
+    ESP_LOGCONFIG(TAG, "  Waveform Capture: %u samples of %u channels", this->capture_samples_, this->capture_width_);
+  }
+  if(this->integrity_interval_) {
+    ESP_LOGCONFIG(TAG, "  Integrity Check Interval: %u ms", this->integrity_interval_);
+    LOG_SENSOR("    ", "Integrity Events", this->integrity_events_sensor_);
+  }
+  switch(this->verify_mode_) {
+    case VERIFY_PER_REGISTER:
+      ESP_LOGCONFIG(TAG, "  Verify: per register");
+      break;
+    case VERIFY_PER_BATCH:
+      ESP_LOGCONFIG(TAG, "  Verify: per batch");
+      break;
+    case VERIFY_NONE:
+      ESP_LOGCONFIG(TAG, "  Verify: none");
+      break;
+  }
+  if(this->restore_energy_) {
+    ESP_LOGCONFIG(TAG, "  Restore energy: flush interval %u ms, min interval %u ms, delta %.1f Wh, on shutdown %s",
+                  this->flush_interval_, this->flush_min_interval_, this->flush_energy_delta_,
+                  this->flush_on_shutdown_ ? "yes" : "no");
+  }
 
   if(this->channel_a_ != nullptr) {
     ESP_LOGCONFIG(TAG, "  Channel A:");
@@ -251,6 +634,31 @@ void ADE7880::dump_config() {
     LOG_SENSOR("    ", "Frequency", this->channel_a_->frequency);
     LOG_SENSOR("    ", "Forward Active Energy", this->channel_a_->forward_active_energy);
     LOG_SENSOR("    ", "Reverse Active Energy", this->channel_a_->reverse_active_energy);
+    LOG_SENSOR("    ", "Forward Reactive Energy", this->channel_a_->forward_reactive_energy);
+    LOG_SENSOR("    ", "Reverse Reactive Energy", this->channel_a_->reverse_reactive_energy);
+    LOG_SENSOR("    ", "Fundamental Voltage", this->channel_a_->fundamental_voltage);
+    LOG_SENSOR("    ", "Fundamental Current", this->channel_a_->fundamental_current);
+    LOG_SENSOR("    ", "Fundamental Active Power", this->channel_a_->fundamental_active_power);
+    LOG_SENSOR("    ", "Fundamental Apparent Power", this->channel_a_->fundamental_apparent_power);
+    LOG_SENSOR("    ", "Fundamental Power Factor", this->channel_a_->fundamental_power_factor);
+    LOG_SENSOR("    ", "Peak Current", this->channel_a_->peak_current);
+    LOG_SENSOR("    ", "Peak Voltage", this->channel_a_->peak_voltage);
+    LOG_SENSOR("    ", "Sag Events", this->channel_a_->sag_events);
+    LOG_SENSOR("    ", "Overvoltage Events", this->channel_a_->overvoltage_events);
+    LOG_SENSOR("    ", "Overcurrent Events", this->channel_a_->overcurrent_events);
+    LOG_SENSOR("    ", "Current Angle", this->channel_a_->current_angle);
+    LOG_SENSOR("    ", "Voltage Angle", this->channel_a_->voltage_angle);
+    LOG_BINARY_SENSOR("    ", "Phase Loss", this->channel_a_->phase_loss);
+    LOG_BINARY_SENSOR("    ", "Reverse Power", this->channel_a_->reverse_power);
+    LOG_SENSOR("    ", "Voltage THD", this->channel_a_->voltage_thd);
+    LOG_SENSOR("    ", "Current THD", this->channel_a_->current_thd);
+    for(uint8_t i=0; i<this->harmonic_slots_; i++) {
+      ESP_LOGCONFIG(TAG, "    Harmonic %u:", this->harmonic_indexes_[i]);
+      LOG_SENSOR("      ", "Voltage", this->channel_a_->voltage_harmonics[i]);
+      LOG_SENSOR("      ", "Current", this->channel_a_->current_harmonics[i]);
+    }
+    LOG_TEXT_SENSOR("    ", "Voltage Spectrum", this->channel_a_->voltage_spectrum);
+    LOG_TEXT_SENSOR("    ", "Current Spectrum", this->channel_a_->current_spectrum);
     ESP_LOGCONFIG(TAG, "    Calibration:");
     ESP_LOGCONFIG(TAG, "      Voltage gain: %.6f", this->channel_a_->voltage_gain_calibration);
     ESP_LOGCONFIG(TAG, "      Current gain: %.6f", this->channel_a_->current_gain_calibration);
@@ -270,6 +678,31 @@ void ADE7880::dump_config() {
     LOG_SENSOR("    ", "Frequency", this->channel_b_->frequency);
     LOG_SENSOR("    ", "Forward Active Energy", this->channel_b_->forward_active_energy);
     LOG_SENSOR("    ", "Reverse Active Energy", this->channel_b_->reverse_active_energy);
+    LOG_SENSOR("    ", "Forward Reactive Energy", this->channel_b_->forward_reactive_energy);
+    LOG_SENSOR("    ", "Reverse Reactive Energy", this->channel_b_->reverse_reactive_energy);
+    LOG_SENSOR("    ", "Fundamental Voltage", this->channel_b_->fundamental_voltage);
+    LOG_SENSOR("    ", "Fundamental Current", this->channel_b_->fundamental_current);
+    LOG_SENSOR("    ", "Fundamental Active Power", this->channel_b_->fundamental_active_power);
+    LOG_SENSOR("    ", "Fundamental Apparent Power", this->channel_b_->fundamental_apparent_power);
+    LOG_SENSOR("    ", "Fundamental Power Factor", this->channel_b_->fundamental_power_factor);
+    LOG_SENSOR("    ", "Peak Current", this->channel_b_->peak_current);
+    LOG_SENSOR("    ", "Peak Voltage", this->channel_b_->peak_voltage);
+    LOG_SENSOR("    ", "Sag Events", this->channel_b_->sag_events);
+    LOG_SENSOR("    ", "Overvoltage Events", this->channel_b_->overvoltage_events);
+    LOG_SENSOR("    ", "Overcurrent Events", this->channel_b_->overcurrent_events);
+    LOG_SENSOR("    ", "Current Angle", this->channel_b_->current_angle);
+    LOG_SENSOR("    ", "Voltage Angle", this->channel_b_->voltage_angle);
+    LOG_BINARY_SENSOR("    ", "Phase Loss", this->channel_b_->phase_loss);
+    LOG_BINARY_SENSOR("    ", "Reverse Power", this->channel_b_->reverse_power);
+    LOG_SENSOR("    ", "Voltage THD", this->channel_b_->voltage_thd);
+    LOG_SENSOR("    ", "Current THD", this->channel_b_->current_thd);
+    for(uint8_t i=0; i<this->harmonic_slots_; i++) {
+      ESP_LOGCONFIG(TAG, "    Harmonic %u:", this->harmonic_indexes_[i]);
+      LOG_SENSOR("      ", "Voltage", this->channel_b_->voltage_harmonics[i]);
+      LOG_SENSOR("      ", "Current", this->channel_b_->current_harmonics[i]);
+    }
+    LOG_TEXT_SENSOR("    ", "Voltage Spectrum", this->channel_b_->voltage_spectrum);
+    LOG_TEXT_SENSOR("    ", "Current Spectrum", this->channel_b_->current_spectrum);
     ESP_LOGCONFIG(TAG, "    Calibration:");
     ESP_LOGCONFIG(TAG, "      Voltage gain: %.6f", this->channel_b_->voltage_gain_calibration);
     ESP_LOGCONFIG(TAG, "      Current gain: %.6f", this->channel_b_->current_gain_calibration);
@@ -289,6 +722,31 @@ void ADE7880::dump_config() {
     LOG_SENSOR("    ", "Frequency", this->channel_c_->frequency);
     LOG_SENSOR("    ", "Forward Active Energy", this->channel_c_->forward_active_energy);
     LOG_SENSOR("    ", "Reverse Active Energy", this->channel_c_->reverse_active_energy);
+    LOG_SENSOR("    ", "Forward Reactive Energy", this->channel_c_->forward_reactive_energy);
+    LOG_SENSOR("    ", "Reverse Reactive Energy", this->channel_c_->reverse_reactive_energy);
+    LOG_SENSOR("    ", "Fundamental Voltage", this->channel_c_->fundamental_voltage);
+    LOG_SENSOR("    ", "Fundamental Current", this->channel_c_->fundamental_current);
+    LOG_SENSOR("    ", "Fundamental Active Power", this->channel_c_->fundamental_active_power);
+    LOG_SENSOR("    ", "Fundamental Apparent Power", this->channel_c_->fundamental_apparent_power);
+    LOG_SENSOR("    ", "Fundamental Power Factor", this->channel_c_->fundamental_power_factor);
+    LOG_SENSOR("    ", "Peak Current", this->channel_c_->peak_current);
+    LOG_SENSOR("    ", "Peak Voltage", this->channel_c_->peak_voltage);
+    LOG_SENSOR("    ", "Sag Events", this->channel_c_->sag_events);
+    LOG_SENSOR("    ", "Overvoltage Events", this->channel_c_->overvoltage_events);
+    LOG_SENSOR("    ", "Overcurrent Events", this->channel_c_->overcurrent_events);
+    LOG_SENSOR("    ", "Current Angle", this->channel_c_->current_angle);
+    LOG_SENSOR("    ", "Voltage Angle", this->channel_c_->voltage_angle);
+    LOG_BINARY_SENSOR("    ", "Phase Loss", this->channel_c_->phase_loss);
+    LOG_BINARY_SENSOR("    ", "Reverse Power", this->channel_c_->reverse_power);
+    LOG_SENSOR("    ", "Voltage THD", this->channel_c_->voltage_thd);
+    LOG_SENSOR("    ", "Current THD", this->channel_c_->current_thd);
+    for(uint8_t i=0; i<this->harmonic_slots_; i++) {
+      ESP_LOGCONFIG(TAG, "    Harmonic %u:", this->harmonic_indexes_[i]);
+      LOG_SENSOR("      ", "Voltage", this->channel_c_->voltage_harmonics[i]);
+      LOG_SENSOR("      ", "Current", this->channel_c_->current_harmonics[i]);
+    }
+    LOG_TEXT_SENSOR("    ", "Voltage Spectrum", this->channel_c_->voltage_spectrum);
+    LOG_TEXT_SENSOR("    ", "Current Spectrum", this->channel_c_->current_spectrum);
     ESP_LOGCONFIG(TAG, "    Calibration:");
     ESP_LOGCONFIG(TAG, "      Voltage gain: %.6f", this->channel_c_->voltage_gain_calibration);
     ESP_LOGCONFIG(TAG, "      Current gain: %.6f", this->channel_c_->current_gain_calibration);
@@ -300,6 +758,11 @@ void ADE7880::dump_config() {
   if(this->channel_n_ != nullptr) {
     ESP_LOGCONFIG(TAG, "  Neutral:");
     LOG_SENSOR("    ", "Current", this->channel_n_->current);
+    LOG_SENSOR("    ", "Current Sum Sample", this->channel_n_->current_sum_sample);
+    LOG_BINARY_SENSOR("    ", "Current Mismatch", this->channel_n_->current_mismatch);
+    if(this->channel_n_->current_mismatch != nullptr) {
+      ESP_LOGCONFIG(TAG, "    Mismatch Level: %.3f A", this->channel_n_->mismatch_level);
+    }
     ESP_LOGCONFIG(TAG, "    Calibration:");
     ESP_LOGCONFIG(TAG, "      Current gain: %.6f", this->channel_n_->current_gain_calibration);
   }
@@ -308,7 +771,10 @@ void ADE7880::dump_config() {
 }
 
 void ADE7880::ade_setup_() {
-  if(!(this->setup_state_ & RESET_BEGIN)) {
+  if(this->setup_state_ & WARM_BEGIN) {
+    this->ade_warm_setup_();
+  }
+  else if(!(this->setup_state_ & RESET_BEGIN)) {
     if(this->reset_pin_ != nullptr) {
       // Hardware reset (page 25)
       ESP_LOGV(TAG, "Hardware reset begin");
@@ -347,8 +813,25 @@ void ADE7880::ade_setup_() {
     if(ade_init_()) {
       ESP_LOGI(TAG, "Initialization done");
       this->reset_watchdog_();
-      this->store_.skip_cycles = 2;
+      // Half full mode discards the first read instead of skipping interrupts
+      this->store_.skip_cycles = this->energy_mode_ == ENERGY_HALF_FULL ? 0 : 2;
+      this->harmonic_step_ = ADE7880_HARMONIC_IDLE;
+      this->harmonic_loaded_group_ = ADE7880_HARMONIC_IDLE;
+      if(this->capturing_) {
+        ESP_LOGW(TAG, "Waveform capture aborted after %u samples", this->capture_count_);
+        this->capturing_ = false;
+        this->high_freq_.stop();
+      }
       this->failure_counter_ = 0;
+      for(PowerChannel *channel : {this->channel_a_, this->channel_b_, this->channel_c_}) {
+        if(channel != nullptr) {
+          channel->watthr_primed_ = false;
+          channel->in_sag_ = false;
+        }
+      }
+      this->set_timeout("ade_checksum", 100, [this]() {
+        this->record_checksum_();
+      });
     }
     else {
       ESP_LOGE(TAG, "Initialization failed");
@@ -365,189 +848,1552 @@ void ADE7880::ade_setup_() {
   }
 }
 
-bool ADE7880::ade_init_() {
-  ESP_LOGD(TAG, "ADE7880 init");
+static uint32_t peak_threshold(float rms, float scale) {
+  float raw = rms * 1.41421356f / scale;
+  return raw >= (float)PEAK_VALUE ? (uint32_t)PEAK_VALUE : (uint32_t)raw;
+}
 
-  int32_t ret = 0;
+// xNOLOAD are levels relative to the full scale power, see the No Load Condition section
+static uint16_t noload_threshold(float level) {
+  static constexpr float PMAX = 27059678.0f;
+  float raw = level / POWER_SCALE / PMAX * 65536.0f;
+  // 0xFFFF is not allowed
+  return raw >= 65534.0f ? 0xFFFE : (uint16_t)raw;
+}
 
-  this->ade_read_verify_(ADE7880_STATUS1, (uint32_t*)&ret);
-  if(ret & STATUS1_RSTDONE) {
-    // Power on reset
-    this->ade_write_verify_(ADE7880_CONFIG2, CONFIG2_I2C_LOCK);
-    this->ade_write_verify_(ADE7880_STATUS1, 0xFFFFFFFF);
-    this->ade_read_verify_(ADE7880_STATUS1, (uint32_t*)&ret);
-  }
+// Source of the value ade_init_() writes to a register
+enum InitSource : uint8_t {
+  INIT_ZERO,
+  INIT_CURRENT_GAIN,
+  INIT_VOLTAGE_GAIN,
+  INIT_POWER_GAIN,
+  INIT_PHASE_CALIBRATION,
+  INIT_NEUTRAL_GAIN,
+  INIT_MISMATCH_LEVEL,
+  INIT_VLEVEL,
+  INIT_OVERCURRENT_LEVEL,
+  INIT_OVERVOLTAGE_LEVEL,
+  INIT_SAG_LEVEL,
+  INIT_MASK0,
+  INIT_MASK1,
+  INIT_LINECYC,
+  INIT_ZXTOUT,
+  INIT_COMPMODE,
+  INIT_MMODE,
+  INIT_LCYCMODE,
+  INIT_PEAKCYC,
+  INIT_SAGCYC,
+  INIT_NO_LOAD,
+};
 
-  this->ade_read_verify_(ADE7880_Version, (uint32_t*)&ret);
-  this->ade_write_verify_(ADE7880_Gain, 0x0000);
-  if(this->frequency_ > 55) {
-    this->ade_write_verify_(ADE7880_COMPMODE, COMPMODE_TERMSEL1 | COMPMODE_TERMSEL2 | COMPMODE_TERMSEL3 | COMPMODE_SELFREQ);
-  }
-  else {
-    this->ade_write_verify_(ADE7880_COMPMODE, COMPMODE_TERMSEL1 | COMPMODE_TERMSEL2 | COMPMODE_TERMSEL3);
-  }
+struct InitRegister {
+  uint16_t reg;
+  InitSource source;
+  uint8_t phase;
+  // Bits compared by the read-back, 0 for all bits of the register
+  uint32_t mask;
+};
 
-  if(this->channel_a_ != nullptr) {
-    this->ade_write_verify_(ADE7880_AVGAIN, this->channel_a_->voltage_gain_calibration);
-    this->ade_write_verify_(ADE7880_AIGAIN, this->channel_a_->current_gain_calibration);
-    this->ade_write_verify_(ADE7880_APGAIN, this->channel_a_->power_gain_calibration);
-    this->ade_write_verify_(ADE7880_APHCAL, this->channel_a_->phase_angle_calibration);
-  }
+// Configuration written by ade_init_(). Registers of a page are in address order, the
+// read-back takes one burst per page. The DSP data memory comes first.
+static constexpr InitRegister INIT_REGISTERS[] = {
+    {ADE7880_AIGAIN, INIT_CURRENT_GAIN, 0, 0xFFFFFF},
+    {ADE7880_AVGAIN, INIT_VOLTAGE_GAIN, 0, 0xFFFFFF},
+    {ADE7880_BIGAIN, INIT_CURRENT_GAIN, 1, 0xFFFFFF},
+    {ADE7880_BVGAIN, INIT_VOLTAGE_GAIN, 1, 0xFFFFFF},
+    {ADE7880_CIGAIN, INIT_CURRENT_GAIN, 2, 0xFFFFFF},
+    {ADE7880_CVGAIN, INIT_VOLTAGE_GAIN, 2, 0xFFFFFF},
+    {ADE7880_NIGAIN, INIT_NEUTRAL_GAIN, 0, 0xFFFFFF},
+    {ADE7880_APGAIN, INIT_POWER_GAIN, 0, 0xFFFFFF},
+    {ADE7880_BPGAIN, INIT_POWER_GAIN, 1, 0xFFFFFF},
+    {ADE7880_CPGAIN, INIT_POWER_GAIN, 2, 0xFFFFFF},
+    {ADE7880_ISUMLVL, INIT_MISMATCH_LEVEL, 0, 0xFFFFFF},
+    {ADE7880_VLEVEL, INIT_VLEVEL, 0, 0xFFFFFFF},
+    {ADE7880_OILVL, INIT_OVERCURRENT_LEVEL, 0, 0},
+    {ADE7880_OVLVL, INIT_OVERVOLTAGE_LEVEL, 0, 0},
+    {ADE7880_SAGLVL, INIT_SAG_LEVEL, 0, 0},
+    // HREADY and DREADY are enabled at runtime
+    {ADE7880_MASK0, INIT_MASK0, 0, ~(uint32_t)(MASK0_HREADY | MASK0_DREADY)},
+    {ADE7880_MASK1, INIT_MASK1, 0, 0},
+    {ADE7880_LINECYC, INIT_LINECYC, 0, 0},
+    {ADE7880_ZXTOUT, INIT_ZXTOUT, 0, 0},
+    {ADE7880_COMPMODE, INIT_COMPMODE, 0, 0},
+    {ADE7880_Gain, INIT_ZERO, 0, 0},
+    {ADE7880_APHCAL, INIT_PHASE_CALIBRATION, 0, 0},
+    {ADE7880_BPHCAL, INIT_PHASE_CALIBRATION, 1, 0},
+    {ADE7880_CPHCAL, INIT_PHASE_CALIBRATION, 2, 0},
+    {ADE7880_MMODE, INIT_MMODE, 0, 0},
+    {ADE7880_LCYCMODE, INIT_LCYCMODE, 0, 0},
+    {ADE7880_PEAKCYC, INIT_PEAKCYC, 0, 0},
+    {ADE7880_SAGCYC, INIT_SAGCYC, 0, 0},
+    // APNOLOAD/VARNOLOAD stay 0, they would stop the energy accumulation below the level
+    {ADE7880_VANOLOAD, INIT_NO_LOAD, 0, 0},
+};
+static constexpr size_t INIT_REGISTER_COUNT = sizeof(INIT_REGISTERS) / sizeof(INIT_REGISTERS[0]);
 
-  if(this->channel_b_ != nullptr) {
-    this->ade_write_verify_(ADE7880_BVGAIN, this->channel_b_->voltage_gain_calibration);
-    this->ade_write_verify_(ADE7880_BIGAIN, this->channel_b_->current_gain_calibration);
-    this->ade_write_verify_(ADE7880_BPGAIN, this->channel_b_->power_gain_calibration);
-    this->ade_write_verify_(ADE7880_BPHCAL, this->channel_b_->phase_angle_calibration);
-  }
+// Wire masks of the INIT_REGISTERS entries, resolved at compile time. ade_write_() only
+// masks to the communication width, the signed registers need their ZP/ZPSE mask.
+struct InitMasks {
+  uint32_t wire[INIT_REGISTER_COUNT];
+  uint32_t verify[INIT_REGISTER_COUNT];
+};
 
-  if(this->channel_c_ != nullptr) {
-    this->ade_write_verify_(ADE7880_CVGAIN, this->channel_c_->voltage_gain_calibration);
-    this->ade_write_verify_(ADE7880_CIGAIN, this->channel_c_->current_gain_calibration);
-    this->ade_write_verify_(ADE7880_CPGAIN, this->channel_c_->power_gain_calibration);
-    this->ade_write_verify_(ADE7880_CPHCAL, this->channel_c_->phase_angle_calibration);
+static constexpr InitMasks init_masks() {
+  InitMasks masks{};
+  for(size_t i=0; i<INIT_REGISTER_COUNT; i++) {
+    masks.wire[i] = ade_reg_codec(INIT_REGISTERS[i].reg).mask;
+    masks.verify[i] = masks.wire[i] & (INIT_REGISTERS[i].mask ? INIT_REGISTERS[i].mask : 0xFFFFFFFF);
   }
+  return masks;
+}
+static constexpr InitMasks INIT_MASKS = init_masks();
 
-  // Write last value 3 times
-  if(this->channel_n_ != nullptr) {
-    this->ade_write_verify_(ADE7880_NIGAIN, this->channel_n_->current_gain_calibration);
-    this->ade_write_verify_(ADE7880_NIGAIN, this->channel_n_->current_gain_calibration);
-    this->ade_write_verify_(ADE7880_NIGAIN, this->channel_n_->current_gain_calibration);
-  }
-  else {
-    this->ade_write_verify_(ADE7880_NIGAIN, 0);
-    this->ade_write_verify_(ADE7880_NIGAIN, 0);
-    this->ade_write_verify_(ADE7880_NIGAIN, 0);
-  }
+static constexpr bool is_dsp_memory(uint16_t reg) { return reg >= ADE7880_AIGAIN && reg <= 0x43BF; }
 
-  bool error = false;
-  if(this->channel_a_ != nullptr) {
-    if(!this->ade_read_check_(ADE7880_AVGAIN, this->channel_a_->voltage_gain_calibration, 0xFFFFFF)) {
-      ESP_LOGE(TAG, "Channel A voltage gain calibration failed");
-      error = true;
+bool ADE7880::init_value_(uint8_t index, uint32_t *value) const {
+  const InitRegister &entry = INIT_REGISTERS[index];
+  const PowerChannel *channels[3] = {this->channel_a_, this->channel_b_, this->channel_c_};
+  const PowerChannel *channel = channels[entry.phase];
+  // Power quality thresholds are rms levels of a sine scaled to its peak. Waveform samples
+  // share the LSB weight of xVRMS and xIRMS.
+  switch(entry.source) {
+    case INIT_ZERO:
+      *value = 0;
+      return true;
+    case INIT_CURRENT_GAIN:
+      *value = channel != nullptr ? channel->current_gain_calibration : 0;
+      return channel != nullptr;
+    case INIT_VOLTAGE_GAIN:
+      *value = channel != nullptr ? channel->voltage_gain_calibration : 0;
+      return channel != nullptr;
+    case INIT_POWER_GAIN:
+      *value = channel != nullptr ? channel->power_gain_calibration : 0;
+      return channel != nullptr;
+    case INIT_PHASE_CALIBRATION:
+      *value = channel != nullptr ? channel->phase_angle_calibration : 0;
+      return channel != nullptr;
+    case INIT_NEUTRAL_GAIN:
+      *value = this->channel_n_ != nullptr ? this->channel_n_->current_gain_calibration : 0;
+      return true;
+    case INIT_MISMATCH_LEVEL:
+      // Compared with the difference of ISUM and the neutral current sample
+      *value = this->mask1_ & MASK1_MISMTCH ? peak_threshold(this->channel_n_->mismatch_level, CURRENT_SCALE) : 0;
+      return this->mask1_ & MASK1_MISMTCH;
+    case INIT_VLEVEL:
+      // Equation 22, VLEVEL = U_FS / U_n * 491520 with U_FS the rms voltage at full scale input.
+      // The fundamental powers and the harmonic results depend on it.
+      *value = (uint32_t)(VOLTAGE_RMS_FULL_SCALE * VOLTAGE_SCALE / this->nominal_voltage_ * 491520.0f);
+      return true;
+    case INIT_OVERCURRENT_LEVEL:
+      *value = peak_threshold(this->overcurrent_level_, CURRENT_SCALE);
+      return this->mask1_ & MASK1_OI;
+    case INIT_OVERVOLTAGE_LEVEL:
+      *value = peak_threshold(this->overvoltage_level_, VOLTAGE_SCALE);
+      return this->mask1_ & MASK1_OV;
+    case INIT_SAG_LEVEL:
+      *value = peak_threshold(this->sag_level_, VOLTAGE_SCALE);
+      return this->mask1_ & MASK1_SAG;
+    case INIT_SAGCYC:
+      *value = this->sag_cycles_;
+      return this->mask1_ & MASK1_SAG;
+    case INIT_MASK0:
+      *value = this->mask0_;
+      return true;
+    case INIT_MASK1:
+      *value = this->mask1_;
+      return this->mask1_ != 0;
+    case INIT_LINECYC:
+      // 1 second update rate -> 2*frequency half cycles
+      *value = this->frequency_ * 2;
+      return true;
+    case INIT_ZXTOUT: {
+      // ZXTOUT counts 62.5 us periods
+      uint32_t zxtout = this->zero_crossing_timeout_ * 16;
+      *value = zxtout > 0xFFFF ? 0xFFFF : zxtout;
+      return this->mask1_ & (MASK1_ZXTOVA | MASK1_ZXTOVB | MASK1_ZXTOVC);
     }
-    if(!this->ade_read_check_(ADE7880_AIGAIN, this->channel_a_->current_gain_calibration, 0xFFFFFF)) {
-      ESP_LOGE(TAG, "Channel A current gain calibration failed");
-      error = true;
+    case INIT_COMPMODE:
+      *value = this->compmode_;
+      return true;
+    case INIT_MMODE:
+      *value = MMODE_VALUE;
+      return true;
+    case INIT_LCYCMODE:
+      // Line cycle mode latches the energy of each period into xWATTHR and xFVARHR. In running
+      // total mode they accumulate without read-with-reset and only VA-hours run in line cycle mode
+      // to generate the LENERGY interrupt. Half full mode reads them with reset on update and on
+      // the AEHF/FREHF interrupt, line cycle accumulation stays off.
+      if(this->energy_mode_ == ENERGY_RUNNING_TOTAL) {
+        *value = LCYCMODE_LVA | LCYCMODE_ZXSEL_0;
+      }
+      else if(this->energy_mode_ == ENERGY_HALF_FULL) {
+        *value = LCYCMODE_RSTREAD | LCYCMODE_ZXSEL_0;
+      }
+      else {
+        *value = LCYCMODE_LWATT | LCYCMODE_LVAR | LCYCMODE_ZXSEL_0;
+      }
+      return true;
+    case INIT_PEAKCYC:
+      // Peak sensors without peak events record one window a second, independent of the
+      // energy mode
+      *value = this->peak_cycles_;
+      if(*value == 0 && this->peaks_enabled_) {
+        *value = (uint8_t)(this->frequency_ * 2);
+      }
+      return *value > 0;
+    case INIT_NO_LOAD:
+      // Apparent power only, the VANLPHASE bits of PHNOLOAD drive update_no_load_()
+      *value = noload_threshold(this->no_load_level_);
+      return this->no_load_level_ > 0.0f;
+  }
+  return false;
+}
+
+i2c::ErrorCode ADE7880::ade_write_init_() {
+  // Writes are chained with repeated starts and checked by one read-back at the end instead
+  // of LAST_OP/LAST_ADD after each of them. The chip has no burst write.
+  uint32_t values[INIT_REGISTER_COUNT];
+  bool used[INIT_REGISTER_COUNT];
+  int8_t dsp_last = -1;
+  i2c::ErrorCode err = i2c::ERROR_OK;
+  for(uint8_t i=0; i<INIT_REGISTER_COUNT && err == i2c::ERROR_OK; i++) {
+    const InitRegister &entry = INIT_REGISTERS[i];
+    if(this->op_count_ + 3 > ADE7880_MAX_OPS) {
+      err = this->ade_commit_(false);
     }
-    if(!this->ade_read_check_(ADE7880_APGAIN, this->channel_a_->power_gain_calibration, 0xFFFFFF)) {
-      ESP_LOGE(TAG, "Channel A power gain calibration failed");
-      error = true;
+    used[i] = this->init_value_(i, &values[i]);
+    if(used[i]) {
+      values[i] &= INIT_MASKS.wire[i];
+      this->ade_queue_write_(entry.reg, values[i]);
+      if(is_dsp_memory(entry.reg)) {
+        dsp_last = i;
+      }
     }
-    if(!this->ade_read_check_(ADE7880_APHCAL, this->channel_a_->phase_angle_calibration, 0xFFFFFF)) {
-      ESP_LOGE(TAG, "Channel A phase angle calibration failed");
-      error = true;
+    if(dsp_last >= 0 && (i + 1 == INIT_REGISTER_COUNT || !is_dsp_memory(INIT_REGISTERS[i + 1].reg))) {
+      // The last write to the DSP data memory only reaches it after two more (page 40)
+      this->ade_queue_write_(INIT_REGISTERS[dsp_last].reg, values[dsp_last]);
+      this->ade_queue_write_(INIT_REGISTERS[dsp_last].reg, values[dsp_last]);
+      dsp_last = -1;
     }
   }
-  if(this->channel_b_ != nullptr) {
-    if(!this->ade_read_check_(ADE7880_BVGAIN, this->channel_b_->voltage_gain_calibration, 0xFFFFFF)) {
-      ESP_LOGE(TAG, "Channel B voltage gain calibration failed");
-      error = true;
-    }
-    if(!this->ade_read_check_(ADE7880_BIGAIN, this->channel_b_->current_gain_calibration, 0xFFFFFF)) {
-      ESP_LOGE(TAG, "Channel B current gain calibration failed");
-      error = true;
+  if(err == i2c::ERROR_OK) {
+    err = this->ade_commit_(false);
+  }
+  if(err != i2c::ERROR_OK) {
+    return err;
+  }
+  return this->ade_verify_init_();
+}
+
+i2c::ErrorCode ADE7880::ade_verify_init_() {
+  uint32_t values[INIT_REGISTER_COUNT];
+  bool used[INIT_REGISTER_COUNT];
+  for(uint8_t i=0; i<INIT_REGISTER_COUNT; i++) {
+    used[i] = this->init_value_(i, &values[i]);
+  }
+
+  // One burst per run of consecutive table registers, up to the last one written. Registers
+  // outside INIT_REGISTERS are never read back.
+  i2c::ErrorCode err = i2c::ERROR_OK;
+  uint8_t i = 0;
+  while(i < INIT_REGISTER_COUNT && err == i2c::ERROR_OK) {
+    if(!used[i]) {
+      i++;
+      continue;
     }
-    if(!this->ade_read_check_(ADE7880_BPGAIN, this->channel_b_->power_gain_calibration, 0xFFFFFF)) {
-      ESP_LOGE(TAG, "Channel B power gain calibration failed");
-      error = true;
+    uint16_t first = INIT_REGISTERS[i].reg;
+    uint8_t last = i;
+    for(uint8_t k=i+1; k<INIT_REGISTER_COUNT; k++) {
+      uint16_t reg = INIT_REGISTERS[k].reg;
+      if(reg != INIT_REGISTERS[k - 1].reg + 1 || ade_reg_size(reg) != ade_reg_size(first) ||
+         reg - first >= ADE7880_MAX_BURST_READ) {
+        break;
+      }
+      if(used[k]) {
+        last = k;
+      }
     }
-    if(!this->ade_read_check_(ADE7880_BPHCAL, this->channel_b_->phase_angle_calibration, 0xFFFFFF)) {
-      ESP_LOGE(TAG, "Channel B phase angle calibration failed");
-      error = true;
+    uint32_t burst[ADE7880_MAX_BURST_READ];
+    err = this->ade_read_burst_verify_(first, burst, INIT_REGISTERS[last].reg - first + 1);
+    for(uint8_t k=i; k<=last && err == i2c::ERROR_OK; k++) {
+      const InitRegister &entry = INIT_REGISTERS[k];
+      uint32_t mask = INIT_MASKS.verify[k];
+      uint32_t read = burst[entry.reg - first];
+      if(used[k] && ((read ^ values[k]) & mask)) {
+        ESP_LOGE(TAG, "Register 0x%04X reads 0x%08X instead of 0x%08X", entry.reg, read, values[k] & mask);
+        err = i2c::ERROR_UNKNOWN;
+      }
     }
+    i = last + 1;
   }
-  if(this->channel_c_ != nullptr) {
-    if(!this->ade_read_check_(ADE7880_CVGAIN, this->channel_c_->voltage_gain_calibration, 0xFFFFFF)) {
-      ESP_LOGE(TAG, "Channel C voltage gain calibration failed");
-      error = true;
-    }
-    if(!this->ade_read_check_(ADE7880_CIGAIN, this->channel_c_->current_gain_calibration, 0xFFFFFF)) {
-      ESP_LOGE(TAG, "Channel C current gain calibration failed");
-      error = true;
+  return err;
+}
+
+void ADE7880::ade_warm_setup_() {
+  if(!(this->setup_state_ & WARM_RESTORED)) {
+    // A chip that went through a reset has RSTDONE set and the DSP stopped
+    uint32_t run = 0;
+    uint32_t status1 = STATUS1_RSTDONE;
+    this->ade_queue_read_(ADE7880_Run, &run, 1);
+    this->ade_queue_read_(ADE7880_STATUS1, &status1, 1);
+    i2c::ErrorCode err = this->ade_commit_();
+    if(err == i2c::ERROR_OK) {
+      err = this->ade_verify_batch_();
     }
-    if(!this->ade_read_check_(ADE7880_CPGAIN, this->channel_c_->power_gain_calibration, 0xFFFFFF)) {
-      ESP_LOGE(TAG, "Channel C power gain calibration failed");
-      error = true;
+    if(err == i2c::ERROR_OK && (run & RUN_START) && !(status1 & STATUS1_RSTDONE)) {
+      // Registers changed at runtime go back to the values CHECKSUM was read with. MMODE is
+      // constant since the peaks of all phases are tracked, it is written along so the
+      // comparison doesn't depend on it.
+      this->ade_queue_write_(ADE7880_MASK0, this->checksum_.mask0);
+      this->ade_queue_write_(ADE7880_MASK1, this->checksum_.mask1);
+      this->ade_queue_write_(ADE7880_COMPMODE, this->checksum_.compmode);
+      this->ade_queue_write_(ADE7880_MMODE, MMODE_VALUE);
+      err = this->ade_commit_();
     }
-    if(!this->ade_read_check_(ADE7880_CPHCAL, this->channel_c_->phase_angle_calibration, 0xFFFFFF)) {
-      ESP_LOGE(TAG, "Channel C phase angle calibration failed");
-      error = true;
+    else if(err == i2c::ERROR_OK) {
+      ESP_LOGW(TAG, "Chip was reset");
+      err = i2c::ERROR_UNKNOWN;
     }
-  }
-  if(this->channel_n_ != nullptr) {
-    if(!this->ade_read_check_(ADE7880_NIGAIN, this->channel_n_->current_gain_calibration, 0xFFFFFF)) {
-      ESP_LOGE(TAG, "Neutral current gain calibration failed");
-      error = true;
+    if(err != i2c::ERROR_OK) {
+      this->setup_state_ = 0;
+      this->ade_setup_();
+      return;
     }
-  }
-
-  if(error) {
-    ESP_LOGE(TAG, "Failed to initialize parameters");
-
-    this->set_timeout("ade_setup", 10000, [this]() {
+    this->setup_state_ |= WARM_RESTORED;
+    this->reset_watchdog_();
+    // CHECKSUM follows register changes with a delay
+    this->set_timeout("ade_setup", 20, [this]() {
       this->ade_setup_();
     });
-
-    return false;
+    return;
   }
 
-  // TODO: magic number to constant
-  if(this->ade_write_verify_(ADE7880_LCYCMODE, LCYCMODE_LWATT | LCYCMODE_ZXSEL_0) != i2c::ERROR_OK) {
-    ESP_LOGE(TAG, "Failed to write ADE7880_LCYCMODE");
-    return false;
+  uint32_t checksum = 0;
+  if(this->ade_read_verify_(ADE7880_CHECKSUM, &checksum) != i2c::ERROR_OK || checksum != this->checksum_.checksum) {
+    ESP_LOGW(TAG, "Checksum 0x%08X instead of 0x%08X, re-initializing", checksum, this->checksum_.checksum);
+    this->setup_state_ = 0;
+    this->ade_setup_();
+    return;
   }
 
-  // 1 second update rate -> 2*frequency half cycles
-  if(this->ade_write_verify_(ADE7880_LINECYC, this->frequency_ * 2)  != i2c::ERROR_OK) {
-    ESP_LOGE(TAG, "Failed to write ADE7880_LINECYC");
-    return false;
+  // Energy keeps accumulating in the chip, only the line cycles of the outage are lost
+  ESP_LOGI(TAG, "Configuration intact, resuming without reset");
+  this->harmonic_step_ = ADE7880_HARMONIC_IDLE;
+  if(this->capturing_) {
+    ESP_LOGW(TAG, "Waveform capture aborted after %u samples", this->capture_count_);
+    this->capturing_ = false;
+    this->high_freq_.stop();
+  }
+  this->select_angles_(this->checksum_.compmode & COMPMODE_ANGLESEL_11);
+  // Events masked since the recording and lost phases need MASK1 as setup_events_() has it
+  this->setup_events_();
+  if(this->mask1_ != this->checksum_.mask1) {
+    this->ade_queue_write_(ADE7880_MASK1, this->mask1_);
+  }
+  if(this->mask0_ != this->checksum_.mask0) {
+    this->ade_queue_write_(ADE7880_MASK0, this->mask0_);
+  }
+  if(this->ade_commit_() != i2c::ERROR_OK) {
+    ESP_LOGE(TAG, "Failed to write interrupt masks");
+  }
+  this->failure_counter_ = 0;
+  this->setup_state_ = RESET_BEGIN | RESET_DONE | INIT_DONE;
+  this->reset_watchdog_();
+  // Flags raised during the outage hold the IRQ pins low without a new edge
+  if(!this->irq0_pin_->digital_read()) {
+    this->store_.irq0_state = 1;
+  }
+  if(this->mask1_ && !this->irq1_pin_->digital_read()) {
+    this->irq1_retrigger_ = true;
   }
+}
 
-  // TODO: magic number to constant
-  this->ade_write_verify_(ADE7880_MASK0, MASK0_LENERGY);
-  if(this->ade_verify_write_(ADE7880_MASK0)  != i2c::ERROR_OK) {
-    ESP_LOGE(TAG, "Failed to write MASK0 register");
-    return false;
+void ADE7880::record_checksum_() {
+  // Read once the DSP caught up with the init writes, the runtime registers are recorded along
+  uint32_t checksum = 0;
+  if(this->ade_read_verify_(ADE7880_CHECKSUM, &checksum) != i2c::ERROR_OK) {
+    ESP_LOGW(TAG, "Failed to read CHECKSUM register, recovery will re-initialize");
+    return;
   }
+  this->checksum_.checksum = checksum;
+  this->checksum_.mask0 = this->mask0_active_();
+  this->checksum_.mask1 = this->mask1_;
+  this->checksum_.compmode = this->compmode_;
+  ESP_LOGD(TAG, "Configuration checksum 0x%08X", checksum);
+}
 
-  // TODO: magic number to constant
-  this->ade_write_(ADE7880_MASK0, MASK0_LENERGY);
-  // Enable write protection (see page 40)
-  this->ade_write_(ADE7880_DSPWP_SEL, 0xad);
-  this->ade_write_(ADE7880_DSPWP_SET, 0x80);
-  // Start DSP
-  this->ade_write_verify_(ADE7880_Run, 0x0001);
+static bool same_state(const ADE7880Checksum &known, const ADE7880Checksum &state) {
+  return known.checksum && known.mask0 == state.mask0 && known.mask1 == state.mask1 &&
+         known.compmode == state.compmode;
+}
+
+void ADE7880::check_integrity_(bool confirm) {
+  // A capture reads at the DREADY rate, it isn't delayed by a read-back
+  if(!(this->setup_state_ & INIT_DONE) || !this->checksum_.checksum || this->capturing_) {
+    return;
+  }
+  ADE7880Checksum state{0, this->mask0_active_(), this->mask1_, this->compmode_};
+  if(this->ade_read_(ADE7880_CHECKSUM, &state.checksum) != i2c::ERROR_OK) {
+    ESP_LOGW(TAG, "Failed to read CHECKSUM register");
+    return;
+  }
+
+  const ADE7880Checksum *known = same_state(this->checksum_, state) ? &this->checksum_ : nullptr;
+  for(const ADE7880Checksum &entry : this->known_checksums_) {
+    if(known == nullptr && same_state(entry, state)) {
+      known = &entry;
+    }
+  }
+  if(known != nullptr && known->checksum == state.checksum) {
+    this->integrity_repaired_ = false;
+    return;
+  }
+  if(!confirm) {
+    // CHECKSUM follows register changes with a delay and a bus glitch doesn't repeat
+    this->set_timeout("ade_integrity", 20, [this]() {
+      this->check_integrity_(true);
+    });
+    return;
+  }
+  if(known == nullptr && this->ade_verify_init_() == i2c::ERROR_OK) {
+    ESP_LOGD(TAG, "Configuration checksum 0x%08X with MASK0 0x%08X, MASK1 0x%08X, COMPMODE 0x%04X",
+             state.checksum, state.mask0, state.mask1, state.compmode);
+    this->known_checksums_[this->known_checksum_next_] = state;
+    this->known_checksum_next_ = (this->known_checksum_next_ + 1) % ADE7880_KNOWN_CHECKSUMS;
+    return;
+  }
+
+  this->integrity_events_++;
+  if(this->integrity_events_sensor_ != nullptr) {
+    this->integrity_events_sensor_->publish_state(this->integrity_events_);
+  }
+  if(this->integrity_repaired_) {
+    // The corruption is outside of the init registers or keeps coming back
+    ESP_LOGE(TAG, "Checksum 0x%08X after repair, re-initializing", state.checksum);
+    this->integrity_repaired_ = false;
+    this->setup_state_ = 0;
+    this->ade_setup_();
+    return;
+  }
+  ESP_LOGW(TAG, "Checksum 0x%08X changed, re-applying configuration", state.checksum);
+  this->repair_configuration_();
+}
+
+void ADE7880::repair_configuration_() {
+  // The registers written by ade_init_(), the DSP keeps running and energy keeps accumulating
+  i2c::ErrorCode err = this->ade_write_protect_(false);
+  if(err == i2c::ERROR_OK) {
+    err = this->ade_write_init_();
+  }
+  if(err == i2c::ERROR_OK && this->mask0_active_() != this->mask0_) {
+    err = this->ade_write_verify_(ADE7880_MASK0, this->mask0_active_());
+  }
+  // Relock even after a failure, an unlocked DSP memory is left to the re-init otherwise
+  i2c::ErrorCode lock = this->ade_write_protect_(true);
+  if(err != i2c::ERROR_OK || lock != i2c::ERROR_OK) {
+    ESP_LOGE(TAG, "Failed to re-apply configuration, re-initializing");
+    this->setup_state_ = 0;
+    this->ade_setup_();
+    return;
+  }
+  // A checksum learned during a corruption would trigger repairs forever
+  for(ADE7880Checksum &entry : this->known_checksums_) {
+    entry.checksum = 0;
+  }
+  this->integrity_repaired_ = true;
+}
+
+bool ADE7880::ade_init_() {
+  ESP_LOGD(TAG, "ADE7880 init");
+
+  this->checksum_.checksum = 0;
+  for(ADE7880Checksum &entry : this->known_checksums_) {
+    entry.checksum = 0;
+  }
+
+  int32_t ret = 0;
+
+  this->ade_read_verify_(ADE7880_STATUS1, (uint32_t*)&ret);
+  if(ret & STATUS1_RSTDONE) {
+    // Power on reset
+    this->ade_write_verify_(ADE7880_CONFIG2, CONFIG2_I2C_LOCK);
+    this->ade_write_verify_(ADE7880_STATUS1, 0xFFFFFFFF);
+    this->ade_read_verify_(ADE7880_STATUS1, (uint32_t*)&ret);
+  }
+
+  this->ade_read_verify_(ADE7880_Version, (uint32_t*)&ret);
+  this->compmode_ = COMPMODE_TERMSEL1 | COMPMODE_TERMSEL2 | COMPMODE_TERMSEL3;
+  if(this->frequency_ > 55) {
+    this->compmode_ |= COMPMODE_SELFREQ;
+  }
+  this->select_angles_(this->anglesel_);
+
+  this->mask0_ = MASK0_LENERGY;
+  if(this->energy_mode_ == ENERGY_HALF_FULL) {
+    this->mask0_ = MASK0_AEHF;
+    if(this->reactive_energy_enabled_) {
+      this->mask0_ |= MASK0_FREHF;
+    }
+  }
+  this->mask0_ |= this->reverse_mask0_;
+  this->setup_events_();
+
+  if(this->ade_write_init_() != i2c::ERROR_OK) {
+    ESP_LOGE(TAG, "Failed to initialize parameters");
+
+    this->set_timeout("ade_setup", 10000, [this]() {
+      this->ade_setup_();
+    });
+
+    return false;
+  }
+
+  // Enable write protection
+  this->ade_write_protect_(true);
+  // Start DSP
+  this->ade_write_verify_(ADE7880_Run, RUN_START);
 
   return true;
 }
 
-void ADE7880::publish_sensor(sensor::Sensor *sensor, uint16_t reg, float factor) {
-  int32_t val;
+void ADE7880::setup_blocks_() {
+  // AIRMS..ISUM (0x43C0-0x43C7): current/voltage pairs per phase followed by neutral current and
+  // the sum of the phase current samples
+  static const float RMS_SCALES[8] = {CURRENT_SCALE, VOLTAGE_SCALE, CURRENT_SCALE, VOLTAGE_SCALE,
+                                      CURRENT_SCALE, VOLTAGE_SCALE, CURRENT_SCALE, CURRENT_SCALE};
+  // AWATT..CWATT (0xE513-0xE515) and AVA..CVA (0xE519-0xE51B)
+  static const float POWER_SCALES[3] = {POWER_SCALE, POWER_SCALE, POWER_SCALE};
+  // APF..CPF and APERIOD..CPERIOD (0xE902-0xE907)
+  static const float PF_PERIOD_SCALES[6] = {PF_SCALE, PF_SCALE, PF_SCALE, PERIOD_CLOCK, PERIOD_CLOCK, PERIOD_CLOCK};
 
-  if(sensor == nullptr) {
+  static const float ANGLE_SCALES[3] = {360.0f, 360.0f, 360.0f};
+
+  ADE7880Block *rms = &this->blocks_[0];
+  ADE7880Block *watt = &this->blocks_[1];
+  ADE7880Block *va = &this->blocks_[2];
+  ADE7880Block *pf_period = &this->blocks_[3];
+  // ANGLE0..ANGLE2 (0xE601-0xE603), delays in periods of the 256 kHz clock
+  ADE7880Block *angle = &this->blocks_[4];
+  const float *scales[ADE7880_BLOCK_COUNT] = {RMS_SCALES, POWER_SCALES, POWER_SCALES, PF_PERIOD_SCALES, ANGLE_SCALES};
+  rms->reg = ADE7880_AIRMS;
+  watt->reg = ADE7880_AWATT;
+  va->reg = ADE7880_AVA;
+  pf_period->reg = ADE7880_APF;
+  pf_period->reciprocal_from = 3;
+  angle->reg = ADE7880_ANGLE0;
+  bool current_angles = false;
+  bool voltage_angles = false;
+
+  PowerChannel *channels[3] = {this->channel_a_, this->channel_b_, this->channel_c_};
+  for(uint8_t i=0; i<3; i++) {
+    if(channels[i] == nullptr) {
+      continue;
+    }
+    rms->sensors[2*i] = channels[i]->current;
+    rms->sensors[2*i + 1] = channels[i]->voltage;
+    watt->sensors[i] = channels[i]->active_power;
+    va->sensors[i] = channels[i]->apparent_power;
+    rms->load_slots[i] = 1 << (2*i);
+    watt->load_slots[i] = 1 << i;
+    va->load_slots[i] = 1 << i;
+    pf_period->load_slots[i] = 1 << i;
+    // Reactive power is the fundamental FVAR of the harmonic engine, see service_harmonics_()
+    pf_period->sensors[i] = channels[i]->power_factor;
+    pf_period->sensors[3 + i] = channels[i]->frequency;
+    current_angles |= channels[i]->current_angle != nullptr;
+    voltage_angles |= channels[i]->voltage_angle != nullptr;
+  }
+  if(this->channel_n_ != nullptr) {
+    rms->sensors[6] = this->channel_n_->current;
+    rms->sensors[7] = this->channel_n_->current_sum_sample;
+  }
+  this->angles_alternate_ = current_angles && voltage_angles;
+  this->anglesel_ = voltage_angles && !current_angles ? COMPMODE_ANGLESEL_01 : COMPMODE_ANGLESEL_00;
+
+  for(ADE7880Block &block : this->blocks_) {
+    // Only fetch up to the last register with a configured sensor
+    block.count = ADE7880_MAX_BURST;
+    while(block.count > 0 && block.sensors[block.count - 1] == nullptr) {
+      --block.count;
+    }
+    if(&block == angle && (current_angles || voltage_angles)) {
+      // The sensors follow ANGLESEL, see select_angles_()
+      block.count = 3;
+    }
+    // Resolve the register codecs once, decoding is a plain shift and multiply afterwards.
+    // The angle sensors follow ANGLESEL and stay with update().
+    uint8_t index = &block - this->blocks_;
+    for(uint8_t i=0; i<block.count; i++) {
+      block.shifts[i] = ade_reg_codec(block.reg + i).shift;
+      block.scales[i] = scales[index][i];
+      if(&block == angle) {
+        block.scales[i] *= this->frequency_ / PERIOD_CLOCK;
+      }
+      block.groups[i] = &block == angle ? 0 : this->sensor_group_(block.sensors[i]);
+    }
+  }
+}
+
+void ADE7880::update_no_load_() {
+  // PHNOLOAD holds the current state, STATUS1 only flags entering no load. It is not verified,
+  // a misread only affects one update.
+  uint32_t phnoload = 0;
+  if(this->ade_read_(ADE7880_PHNOLOAD, &phnoload) != i2c::ERROR_OK) {
+    ESP_LOGE(TAG, "Failed to read PHNOLOAD register");
+    phnoload = 0;
+  }
+
+  PowerChannel *channels[3] = {this->channel_a_, this->channel_b_, this->channel_c_};
+  for(ADE7880Block &block : this->blocks_) {
+    block.idle = 0;
+  }
+  for(uint8_t i=0; i<3; i++) {
+    PowerChannel *channel = channels[i];
+    if(channel == nullptr) {
+      continue;
+    }
+    bool idle = phnoload & (PHNOLOAD_VANLPHASE_A << i);
+    if(idle && !channel->idle_) {
+      // Published once, the sensors stay quiet until the load returns
+      for(sensor::Sensor *sensor : {channel->current, channel->active_power, channel->apparent_power,
+                                    channel->power_factor}) {
+        if(sensor != nullptr) {
+          sensor->publish_state(0.0f);
+        }
+      }
+    }
+    channel->idle_ = idle;
+    if(idle) {
+      for(ADE7880Block &block : this->blocks_) {
+        block.idle |= block.load_slots[i];
+      }
+    }
+  }
+}
+
+uint8_t ADE7880::sensor_group_(sensor::Sensor *sensor) {
+  for(const auto &entry : this->sensor_intervals_) {
+    if(sensor == nullptr || entry.first != sensor) {
+      continue;
+    }
+    for(uint8_t g=1; g<this->group_count_; g++) {
+      if(this->group_intervals_[g] == entry.second) {
+        return g;
+      }
+    }
+    if(this->group_count_ == ADE7880_MAX_GROUPS) {
+      ESP_LOGW(TAG, "Too many update intervals, %u ms follows update()", entry.second);
+      return 0;
+    }
+    this->group_intervals_[this->group_count_] = entry.second;
+    return this->group_count_++;
+  }
+  return 0;
+}
+
+uint8_t ADE7880::take_due_groups_(bool due) {
+  // Once a pass is due, groups due within a quarter of their interval join it and stay on
+  // their schedule
+  uint32_t now = millis();
+  for(uint8_t g=1; g<this->group_count_ && !due; g++) {
+    due = (int32_t)(this->group_next_[g] - now) <= 0;
+  }
+  if(!due) {
+    return 0;
+  }
+  uint8_t groups = 0;
+  for(uint8_t g=1; g<this->group_count_; g++) {
+    uint32_t interval = this->group_intervals_[g];
+    if((int32_t)(this->group_next_[g] - now) > (int32_t)(interval / 4)) {
+      continue;
+    }
+    groups |= 1 << g;
+    this->group_next_[g] += interval;
+    if((int32_t)(this->group_next_[g] - now) <= 0) {
+      // Late, passes missed during an outage are not caught up
+      this->group_next_[g] = now + interval;
+    }
+  }
+  return groups;
+}
+
+void ADE7880::start_pass_(uint8_t groups) {
+  this->pass_groups_ = groups;
+  this->pending_groups_ = 0;
+  for(ADE7880Block &block : this->blocks_) {
+    block.due = 0;
+    for(uint8_t i=0; i<block.count; i++) {
+      if(block.sensors[i] != nullptr && (groups & (1 << block.groups[i])) && !(block.idle & (1 << i))) {
+        block.due |= 1 << i;
+      }
+    }
+    // One burst up to the last due register
+    uint8_t count = block.count;
+    while(count > 0 && !(block.due & (1 << (count - 1)))) {
+      --count;
+    }
+    block.read_count = count;
+  }
+  this->block_index_ = 0;
+}
+
+void ADE7880::publish_slice_() {
+  uint32_t start = micros();
+  uint8_t first = this->block_index_;
+  bool read = false;
+  // IPEAK/VPEAK ride on the first block read by the pass, the PKI of the latest window may
+  // still be queued
+  bool peaks = this->peaks_enabled_ && first == 0 && (this->pass_groups_ & 1);
+  uint32_t peak_values[2];
+  i2c::ErrorCode peak_err = i2c::ERROR_OK;
+  if(peaks) {
+    this->ade_queue_read_(ADE7880_IPEAK, peak_values, 2);
+  }
+
+  // Read at least one block. A further block is only started when its previous read time still
+  // fits the slice budget, so only the first block of a slice can overrun it.
+  while(this->block_index_ < ADE7880_BLOCK_COUNT) {
+    ADE7880Block *block = &this->blocks_[this->block_index_];
+    if(block->read_count > 0) {
+      if(read && micros() - start + block->read_time > this->slice_budget_) {
+        break;
+      }
+      uint32_t block_start = micros();
+      this->read_block_(block);
+      block->read_time = micros() - block_start;
+      if(!read) {
+        peak_err = block->err;
+      }
+      read = true;
+    }
+    this->block_index_++;
+  }
+
+  if(peaks && !read) {
+    // No block due, the peak registers are read alone
+    peak_err = this->ade_commit_();
+    read = true;
+  }
+
+  // Each slice is verified as one batch, LENERGY servicing may run between slices
+  if(read && this->ade_verify_batch_() != i2c::ERROR_OK) {
+    ESP_LOGE(TAG, "Failed to verify measurement registers");
+    for(uint8_t i=first; i<this->block_index_; i++) {
+      this->blocks_[i].err = i2c::ERROR_UNKNOWN;
+    }
+    peak_err = i2c::ERROR_UNKNOWN;
+  }
+  for(uint8_t i=first; i<this->block_index_; i++) {
+    this->publish_block_(&this->blocks_[i]);
+  }
+  if(peaks) {
+    if(peak_err == i2c::ERROR_OK) {
+      this->record_peaks_(peak_values[0], peak_values[1]);
+    }
+    this->publish_peaks_();
+  }
+
+  this->record_slice_(start);
+  if(this->block_index_ < ADE7880_BLOCK_COUNT || !(this->pass_groups_ & 1)) {
+    // Alternating angles and the slice statistics follow update()
     return;
   }
+  if(this->angles_alternate_) {
+    // The other kind of angles is measured until the next update
+    uint16_t anglesel = (this->compmode_ & COMPMODE_ANGLESEL_01) ? COMPMODE_ANGLESEL_00 : COMPMODE_ANGLESEL_01;
+    this->ade_queue_write_(ADE7880_COMPMODE, (this->compmode_ & ~COMPMODE_ANGLESEL_11) | anglesel);
+    if(this->ade_commit_() == i2c::ERROR_OK) {
+      this->select_angles_(anglesel);
+    }
+    else {
+      ESP_LOGE(TAG, "Failed to write COMPMODE register");
+    }
+  }
+  ESP_LOGV(TAG, "Update done, worst slice %u us", this->max_slice_duration_);
+  if(this->slice_duration_sensor_ != nullptr) {
+    this->slice_duration_sensor_->publish_state(this->max_slice_duration_ / 1000.0f);
+  }
+  this->max_slice_duration_ = 0;
+}
 
-  if(this->ade_read_verify_(reg, (uint32_t*)&val) != i2c::ERROR_OK) {
-    ESP_LOGE(TAG, "Failed to read register 0x%04X", reg);
-    sensor->publish_state(NAN);
+void ADE7880::record_slice_(uint32_t start) {
+  uint32_t duration = micros() - start;
+  if(duration > this->max_slice_duration_) {
+    this->max_slice_duration_ = duration;
+  }
+}
+
+void ADE7880::read_block_(ADE7880Block *block) {
+  if(block->read_count == 0) {
     return;
   }
-  float fval = val;
-  if(factor > 1.0f) {
-    fval /= factor;
+  block->err = this->ade_read_batch_(block->reg, block->values, block->read_count);
+}
+
+void ADE7880::publish_block_(const ADE7880Block *block) {
+  if(block->err != i2c::ERROR_OK) {
+    ESP_LOGE(TAG, "Failed to read registers 0x%04X-0x%04X", block->reg, block->reg + block->read_count - 1);
+    for(uint8_t i=0; i<block->read_count; i++) {
+      if(block->due & (1 << i)) {
+        block->sensors[i]->publish_state(NAN);
+      }
+    }
+    return;
+  }
+  uint8_t reciprocal_from = std::min(block->reciprocal_from, block->read_count);
+  for(uint8_t i=0; i<reciprocal_from; i++) {
+    if(block->due & (1 << i)) {
+      block->sensors[i]->publish_state(block->scales[i] * ade_reg_decode(block->values[i], block->shifts[i]));
+    }
   }
-  else if(factor < 1.0f) {
-    fval = 1/(fval * factor);
+  for(uint8_t i=reciprocal_from; i<block->read_count; i++) {
+    if(block->due & (1 << i)) {
+      block->sensors[i]->publish_state(block->scales[i] / ade_reg_decode(block->values[i], block->shifts[i]));
+    }
   }
-  sensor->publish_state(fval);
 }
 
 void ADE7880::reset_watchdog_() {
-  this->watchdog_ = millis() + this->watchdog_threshold_;
+  uint32_t threshold = this->watchdog_threshold_;
+  if(this->energy_mode_ == ENERGY_HALF_FULL) {
+    // Energy is only read on update
+    threshold += this->get_update_interval();
+  }
+  this->watchdog_ = millis() + threshold;
+}
+
+uint64_t ADE7880::energy_total_(bool reactive) const {
+  uint64_t total = 0;
+  for(PowerChannel *channel : {this->channel_a_, this->channel_b_, this->channel_c_}) {
+    if(channel != nullptr) {
+      total += reactive ? channel->varhr_forward_ + channel->varhr_reverse_
+                        : channel->watthr_forward_ + channel->watthr_reverse_;
+    }
+  }
+  return total;
 }
 
+void ADE7880::restore_energy_state_() {
+  uint32_t hash = fnv1_hash("ade7880_energy") ^ this->address_;
+  this->energy_pref_ = global_preferences->make_preference<ADE7880SavedEnergy>(hash, true);
+
+  ADE7880SavedEnergy saved{};
+  if(!this->energy_pref_.load(&saved)) {
+    ESP_LOGD(TAG, "No saved energy");
+    return;
+  }
+  PowerChannel *channels[3] = {this->channel_a_, this->channel_b_, this->channel_c_};
+  for(uint8_t i=0; i<3; i++) {
+    if(channels[i] != nullptr) {
+      channels[i]->watthr_forward_ = saved.forward[i];
+      channels[i]->watthr_reverse_ = saved.reverse[i];
+      channels[i]->varhr_forward_ = saved.reactive_forward[i];
+      channels[i]->varhr_reverse_ = saved.reactive_reverse[i];
+    }
+  }
+  this->flushed_watthr_ = this->energy_total_(false);
+  this->flushed_varhr_ = this->energy_total_(true);
+  this->last_flush_ = millis();
+  ESP_LOGI(TAG, "Restored saved energy");
+}
+
+void ADE7880::flush_energy_(bool force) {
+  if(!this->restore_energy_) {
+    return;
+  }
+  // Accumulators only grow, unchanged sums mean nothing to save. The delta threshold is on
+  // active energy only, reactive energy goes along with it.
+  uint64_t total = this->energy_total_(false);
+  uint64_t reactive_total = this->energy_total_(true);
+  if(total == this->flushed_watthr_ && reactive_total == this->flushed_varhr_) {
+    return;
+  }
+  if(!force) {
+    // Flush after flush_interval_, or early once flush_energy_delta_ is reached but never
+    // more often than flush_min_interval_. This bounds the flash writes per day.
+    uint32_t elapsed = millis() - this->last_flush_;
+    bool delta_reached = this->flush_energy_delta_ > 0.0f &&
+        (total - this->flushed_watthr_) * ENERGY_SCALE >= this->flush_energy_delta_;
+    if(elapsed < this->flush_interval_ && !(delta_reached && elapsed >= this->flush_min_interval_)) {
+      return;
+    }
+  }
+
+  ADE7880SavedEnergy saved{};
+  PowerChannel *channels[3] = {this->channel_a_, this->channel_b_, this->channel_c_};
+  for(uint8_t i=0; i<3; i++) {
+    if(channels[i] != nullptr) {
+      saved.forward[i] = channels[i]->watthr_forward_;
+      saved.reverse[i] = channels[i]->watthr_reverse_;
+      saved.reactive_forward[i] = channels[i]->varhr_forward_;
+      saved.reactive_reverse[i] = channels[i]->varhr_reverse_;
+    }
+  }
+  if(!this->energy_pref_.save(&saved)) {
+    ESP_LOGW(TAG, "Failed to save energy");
+    return;
+  }
+  this->flushed_watthr_ = total;
+  this->flushed_varhr_ = reactive_total;
+  this->last_flush_ = millis();
+  ESP_LOGD(TAG, "Energy saved");
+}
+
+
+static bool has_fundamental_sensors(const PowerChannel *channel) {
+  return channel->reactive_power != nullptr || channel->fundamental_voltage != nullptr ||
+      channel->fundamental_current != nullptr || channel->fundamental_active_power != nullptr ||
+      channel->fundamental_apparent_power != nullptr || channel->fundamental_power_factor != nullptr;
+}
+
+static bool has_active_energy_sensors(const PowerChannel *channel) {
+  return channel != nullptr &&
+      (channel->forward_active_energy != nullptr || channel->reverse_active_energy != nullptr);
+}
+
+static bool has_reactive_energy_sensors(const PowerChannel *channel) {
+  return channel != nullptr &&
+      (channel->forward_reactive_energy != nullptr || channel->reverse_reactive_energy != nullptr);
+}
+
+static bool has_harmonic_sensors(const PowerChannel *channel) {
+  if(channel == nullptr) {
+    return false;
+  }
+  if(channel->voltage_thd != nullptr || channel->current_thd != nullptr) {
+    return true;
+  }
+  if(has_fundamental_sensors(channel)) {
+    return true;
+  }
+  for(uint8_t i=0; i<ADE7880_HARMONIC_SLOTS; i++) {
+    if(channel->voltage_harmonics[i] != nullptr || channel->current_harmonics[i] != nullptr) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static bool has_spectrum_sensors(const PowerChannel *channel) {
+  return channel != nullptr && (channel->voltage_spectrum != nullptr || channel->current_spectrum != nullptr);
+}
+
+static void publish_harmonic(sensor::Sensor *sensor, i2c::ErrorCode err, uint32_t raw, uint8_t shift) {
+  if(sensor == nullptr) {
+    return;
+  }
+  if(err != i2c::ERROR_OK) {
+    sensor->publish_state(NAN);
+    return;
+  }
+  sensor->publish_state(HARMONIC_SCALE * ade_reg_decode(raw, shift));
+}
+
+static void publish_scaled(sensor::Sensor *sensor, i2c::ErrorCode err, uint32_t raw, uint8_t shift, float scale) {
+  if(sensor == nullptr) {
+    return;
+  }
+  sensor->publish_state(err == i2c::ERROR_OK ? scale * ade_reg_decode(raw, shift) : NAN);
+}
+
+// Text sensor states are limited to 255 characters
+static const size_t SPECTRUM_MAX_LENGTH = 255;
+
+static void publish_spectrum(text_sensor::TextSensor *sensor, const std::vector<float> &spectrum) {
+  if(sensor == nullptr) {
+    return;
+  }
+  // Distortion in % per swept index, comma separated in configuration order. Entries that
+  // don't fit the limit are dropped as a whole, the state is never cut within a number.
+  std::string state;
+  state.reserve(SPECTRUM_MAX_LENGTH);
+  char buf[16];
+  for(size_t i=0; i<spectrum.size(); i++) {
+    int len = snprintf(buf, sizeof(buf), i ? ",%.2f" : "%.2f", spectrum[i]);
+    if(state.size() + len > SPECTRUM_MAX_LENGTH) {
+      ESP_LOGD(TAG, "Spectrum truncated to %u of %u indexes", (unsigned) i, (unsigned) spectrum.size());
+      break;
+    }
+    state += buf;
+  }
+  sensor->publish_state(state);
+}
+
+void ADE7880::setup_harmonics_() {
+  // Fixed result sets are read up to the last HX/HY/HZ slot with a sensor
+  this->harmonic_slots_ = 0;
+  this->harmonics_enabled_ = false;
+  this->fundamental_enabled_ = false;
+  this->reactive_energy_enabled_ = false;
+  bool sweep = false;
+  for(PowerChannel *channel : {this->channel_a_, this->channel_b_, this->channel_c_}) {
+    if(has_reactive_energy_sensors(channel)) {
+      this->reactive_energy_enabled_ = true;
+    }
+    if(has_spectrum_sensors(channel)) {
+      sweep = true;
+      channel->voltage_spectrum_.assign(this->sweep_indexes_.size(), NAN);
+      channel->current_spectrum_.assign(this->sweep_indexes_.size(), NAN);
+    }
+    if(!has_harmonic_sensors(channel)) {
+      continue;
+    }
+    this->harmonics_enabled_ = true;
+    if(has_fundamental_sensors(channel)) {
+      this->fundamental_enabled_ = true;
+    }
+    for(uint8_t i=0; i<ADE7880_HARMONIC_SLOTS; i++) {
+      bool used = channel->voltage_harmonics[i] != nullptr || channel->current_harmonics[i] != nullptr;
+      if(used && this->harmonic_slots_ < i + 1) {
+        this->harmonic_slots_ = i + 1;
+      }
+    }
+  }
+
+  this->harmonic_groups_ = this->harmonics_enabled_ ? 1 : 0;
+  if(sweep) {
+    this->harmonic_groups_ += (this->sweep_indexes_.size() + ADE7880_HARMONIC_SLOTS - 1) / ADE7880_HARMONIC_SLOTS;
+  }
+  this->harmonic_cursor_ = 0;
+}
+
+uint8_t ADE7880::harmonic_group_indexes_(uint8_t group, uint8_t *indexes) const {
+  if(this->harmonics_enabled_) {
+    if(group == 0) {
+      for(uint8_t i=0; i<this->harmonic_slots_; i++) {
+        indexes[i] = this->harmonic_indexes_[i];
+      }
+      return this->harmonic_slots_;
+    }
+    --group;
+  }
+  size_t first = group * ADE7880_HARMONIC_SLOTS;
+  uint8_t count = 0;
+  for(size_t i=first; i<this->sweep_indexes_.size() && count<ADE7880_HARMONIC_SLOTS; i++) {
+    indexes[count++] = this->sweep_indexes_[i];
+  }
+  return count;
+}
+
+bool ADE7880::harmonic_step_used_(uint8_t step) const {
+  PowerChannel *channels[3] = {this->channel_a_, this->channel_b_, this->channel_c_};
+  PowerChannel *channel = channels[step % 3];
+  if(this->harmonics_enabled_ && step / 3 == 0) {
+    return has_harmonic_sensors(channel);
+  }
+  return has_spectrum_sensors(channel);
+}
+
+void ADE7880::queue_harmonic_step_() {
+  static const uint16_t HPHASE[3] = {HCONFIG_HPHASE_A, HCONFIG_HPHASE_B, HCONFIG_HPHASE_C};
+  uint8_t steps = this->harmonic_groups_ * 3;
+  for(uint8_t tries=0; tries<steps && this->harmonic_steps_left_ > 0; tries++) {
+    uint8_t step = this->harmonic_cursor_;
+    this->harmonic_cursor_ = (step + 1) % steps;
+    if(!this->harmonic_step_used_(step)) {
+      continue;
+    }
+    --this->harmonic_steps_left_;
+    this->harmonic_step_ = step;
+
+    uint8_t group = step / 3;
+    if(group != this->harmonic_loaded_group_) {
+      uint8_t indexes[ADE7880_HARMONIC_SLOTS];
+      uint8_t count = this->harmonic_group_indexes_(group, indexes);
+      for(uint8_t i=0; i<count; i++) {
+        this->ade_queue_write_(ADE7880_HX + i, indexes[i]);
+      }
+      this->harmonic_loaded_group_ = group;
+    }
+    // Selecting the phase restarts the harmonic block, HREADY follows once it settled (HSTIME)
+    this->ade_queue_write_(ADE7880_HCONFIG, HCONFIG_HSTIME_750MS | HCONFIG_HRATE_1024MS | HPHASE[step % 3]);
+    this->ade_queue_write_(ADE7880_STATUS0, STATUS0_HREADY);
+    return;
+  }
+
+  // Step budget of this update spent, HREADY stays masked until the next update
+  this->harmonic_step_ = ADE7880_HARMONIC_IDLE;
+  this->ade_queue_write_(ADE7880_MASK0, this->mask0_active_());
+}
+
+void ADE7880::start_harmonics_() {
+  if(this->harmonic_step_ != ADE7880_HARMONIC_IDLE) {
+    ESP_LOGW(TAG, "Previous harmonic steps still in progress, restarting");
+  }
+  // A budget above the number of used steps would analyse a step twice per update
+  uint8_t used = 0;
+  for(uint8_t step=0; step<this->harmonic_groups_ * 3; step++) {
+    used += this->harmonic_step_used_(step);
+  }
+  this->harmonic_steps_left_ = this->harmonic_steps_per_update_;
+  if(this->harmonic_steps_left_ > used) {
+    this->harmonic_steps_left_ = used;
+  }
+  this->queue_harmonic_step_();
+  this->ade_queue_write_(ADE7880_MASK0, this->mask0_active_() | MASK0_HREADY);
+  if(this->ade_commit_() != i2c::ERROR_OK) {
+    ESP_LOGE(TAG, "Failed to start harmonic analysis");
+    this->harmonic_step_ = ADE7880_HARMONIC_IDLE;
+    this->harmonic_loaded_group_ = ADE7880_HARMONIC_IDLE;
+  }
+}
+
+void ADE7880::service_harmonics_() {
+  if(this->harmonic_step_ == ADE7880_HARMONIC_IDLE) {
+    // No step in progress
+    return;
+  }
+  PowerChannel *channels[3] = {this->channel_a_, this->channel_b_, this->channel_c_};
+  PowerChannel *channel = channels[this->harmonic_step_ % 3];
+  uint8_t group = this->harmonic_step_ / 3;
+  uint8_t indexes[ADE7880_HARMONIC_SLOTS];
+  uint8_t count = this->harmonic_group_indexes_(group, indexes);
+
+  // VTHD, ITHD, then 8 registers per HX/HY/HZ result set with xVHD and xIHD at offsets 6 and 7.
+  // The burst starts 6 registers earlier at FVRMS when fundamental quantities are needed.
+  uint32_t burst[ADE7880_MAX_BURST_READ];
+  uint8_t offset = this->fundamental_enabled_ ? ADE7880_VTHD - ADE7880_FVRMS : 0;
+  this->ade_queue_read_(ADE7880_VTHD - offset, burst, offset + 2 + 8 * count);
+  i2c::ErrorCode err = this->ade_commit_();
+  if(err == i2c::ERROR_OK) {
+    err = this->ade_verify_batch_();
+  }
+  if(err != i2c::ERROR_OK) {
+    ESP_LOGE(TAG, "Failed to read harmonic registers");
+  }
+
+  static constexpr uint8_t shift = ade_reg_codec(ADE7880_VTHD).shift;
+  if(offset && group == 0) {
+    // FVRMS, FIRMS, FWATT, FVAR, FVA, FPF are independent of the harmonic indexes,
+    // publish them once per pass over the phases
+    publish_scaled(channel->fundamental_voltage, err, burst[0], shift, VOLTAGE_SCALE);
+    publish_scaled(channel->fundamental_current, err, burst[1], shift, CURRENT_SCALE);
+    publish_scaled(channel->fundamental_active_power, err, burst[2], shift, POWER_SCALE);
+    publish_scaled(channel->reactive_power, err, burst[3], shift, POWER_SCALE);
+    publish_scaled(channel->fundamental_apparent_power, err, burst[4], shift, POWER_SCALE);
+    publish_scaled(channel->fundamental_power_factor, err, burst[5], shift, FPF_SCALE);
+  }
+  const uint32_t *values = burst + offset;
+  publish_harmonic(channel->voltage_thd, err, values[0], shift);
+  publish_harmonic(channel->current_thd, err, values[1], shift);
+  if(this->harmonics_enabled_ && group == 0) {
+    for(uint8_t i=0; i<count; i++) {
+      publish_harmonic(channel->voltage_harmonics[i], err, values[8 + 8 * i], shift);
+      publish_harmonic(channel->current_harmonics[i], err, values[9 + 8 * i], shift);
+    }
+  }
+  else {
+    // Swept values are kept and published as a whole on update
+    size_t first = (group - (this->harmonics_enabled_ ? 1 : 0)) * ADE7880_HARMONIC_SLOTS;
+    for(uint8_t i=0; i<count && !channel->voltage_spectrum_.empty(); i++) {
+      bool ok = err == i2c::ERROR_OK;
+      channel->voltage_spectrum_[first + i] = ok ? HARMONIC_SCALE * ade_reg_decode(values[8 + 8 * i], shift) : NAN;
+      channel->current_spectrum_[first + i] = ok ? HARMONIC_SCALE * ade_reg_decode(values[9 + 8 * i], shift) : NAN;
+    }
+  }
+
+  this->queue_harmonic_step_();
+  if(this->ade_commit_() != i2c::ERROR_OK) {
+    ESP_LOGE(TAG, "Failed to select next harmonic step");
+    this->harmonic_step_ = ADE7880_HARMONIC_IDLE;
+    this->harmonic_loaded_group_ = ADE7880_HARMONIC_IDLE;
+  }
+}
+
+void ADE7880::publish_spectrum_() {
+  for(PowerChannel *channel : {this->channel_a_, this->channel_b_, this->channel_c_}) {
+    if(!has_spectrum_sensors(channel)) {
+      continue;
+    }
+    publish_spectrum(channel->voltage_spectrum, channel->voltage_spectrum_);
+    publish_spectrum(channel->current_spectrum, channel->current_spectrum_);
+  }
+}
+
+void ADE7880::record_peaks_(uint32_t ipeak, uint32_t vpeak) {
+  // IPEAK/VPEAK hold the largest sample of all phases, credited to the phase that produced it
+  static const uint32_t PEAK_PHASES[3] = {PEAK_PHASE_A, PEAK_PHASE_B, PEAK_PHASE_C};
+  PowerChannel *channels[3] = {this->channel_a_, this->channel_b_, this->channel_c_};
+  for(uint8_t i=0; i<3; i++) {
+    PowerChannel *channel = channels[i];
+    if(channel == nullptr) {
+      continue;
+    }
+    if((ipeak & PEAK_PHASES[i]) && (ipeak & PEAK_VALUE) > channel->ipeak_max_) {
+      channel->ipeak_max_ = ipeak & PEAK_VALUE;
+    }
+    if((vpeak & PEAK_PHASES[i]) && (vpeak & PEAK_VALUE) > channel->vpeak_max_) {
+      channel->vpeak_max_ = vpeak & PEAK_VALUE;
+    }
+  }
+}
+
+void ADE7880::publish_peaks_() {
+  // A phase that never held the largest sample during the interval has no known value
+  for(PowerChannel *channel : {this->channel_a_, this->channel_b_, this->channel_c_}) {
+    if(channel == nullptr) {
+      continue;
+    }
+    if(channel->peak_current != nullptr) {
+      channel->peak_current->publish_state(channel->ipeak_max_ ? channel->ipeak_max_ * CURRENT_SCALE : NAN);
+    }
+    if(channel->peak_voltage != nullptr) {
+      channel->peak_voltage->publish_state(channel->vpeak_max_ ? channel->vpeak_max_ * VOLTAGE_SCALE : NAN);
+    }
+    channel->ipeak_max_ = 0;
+    channel->vpeak_max_ = 0;
+  }
+}
+
+uint8_t ADE7880::queue_statistics_(uint32_t *rms, uint32_t *watt) {
+  // AIRMS..CVRMS (0x43C0-0x43C5) and AWATT..CWATT (0xE513-0xE515), rms and watt hold 6 and 3
+  // values. A capture reads at the DREADY rate and isn't delayed.
+  if(!this->statistics_ || this->capturing_) {
+    return 0;
+  }
+  PowerChannel *channels[3] = {this->channel_a_, this->channel_b_, this->channel_c_};
+  uint8_t count = 3;
+  while(count > 0 && channels[count - 1] == nullptr) {
+    --count;
+  }
+  if(count > 0 && (this->statistics_ & (1 << STATISTICS_VOLTAGE | 1 << STATISTICS_CURRENT))) {
+    this->ade_queue_read_(ADE7880_AIRMS, rms, 2 * count);
+  }
+  if(count > 0 && (this->statistics_ & (1 << STATISTICS_ACTIVE_POWER))) {
+    this->ade_queue_read_(ADE7880_AWATT, watt, count);
+  }
+  return count;
+}
+
+void ADE7880::record_statistics_(uint8_t count, const uint32_t *rms, const uint32_t *watt) {
+  static constexpr uint8_t RMS_SHIFT = ade_reg_codec(ADE7880_AIRMS).shift;
+  static constexpr uint8_t WATT_SHIFT = ade_reg_codec(ADE7880_AWATT).shift;
+  PowerChannel *channels[3] = {this->channel_a_, this->channel_b_, this->channel_c_};
+  for(uint8_t i=0; i<count; i++) {
+    PowerChannel *channel = channels[i];
+    if(channel == nullptr) {
+      continue;
+    }
+    if(this->statistics_ & (1 << STATISTICS_VOLTAGE)) {
+      channel->statistics[STATISTICS_VOLTAGE].add(VOLTAGE_SCALE * ade_reg_decode(rms[2*i + 1], RMS_SHIFT));
+    }
+    if(this->statistics_ & (1 << STATISTICS_CURRENT)) {
+      channel->statistics[STATISTICS_CURRENT].add(CURRENT_SCALE * ade_reg_decode(rms[2*i], RMS_SHIFT));
+    }
+    if(this->statistics_ & (1 << STATISTICS_ACTIVE_POWER)) {
+      channel->statistics[STATISTICS_ACTIVE_POWER].add(POWER_SCALE * ade_reg_decode(watt[i], WATT_SHIFT));
+    }
+  }
+}
+
+void ADE7880::sample_statistics_() {
+  // Half full mode has no periodic energy service, the samples take their own transaction
+  if(!(this->setup_state_ & INIT_DONE) || this->store_.skip_cycles > 0) {
+    return;
+  }
+  uint32_t rms[6];
+  uint32_t watt[3];
+  uint8_t count = this->queue_statistics_(rms, watt);
+  if(count == 0) {
+    return;
+  }
+  i2c::ErrorCode err = this->ade_commit_();
+  if(err == i2c::ERROR_OK) {
+    err = this->ade_verify_batch_();
+  }
+  if(err != i2c::ERROR_OK) {
+    ESP_LOGE(TAG, "Failed to read statistics registers");
+    return;
+  }
+  this->record_statistics_(count, rms, watt);
+}
+
+void ADE7880::publish_statistics_() {
+  for(PowerChannel *channel : {this->channel_a_, this->channel_b_, this->channel_c_}) {
+    if(channel == nullptr) {
+      continue;
+    }
+    for(ADE7880Statistics &statistics : channel->statistics) {
+      statistics.publish();
+    }
+  }
+}
+
+void ADE7880Statistics::add(float value) {
+  if(this->count_ == 0 || value < this->low_) {
+    this->low_ = value;
+  }
+  if(this->count_ == 0 || value > this->high_) {
+    this->high_ = value;
+  }
+  this->count_++;
+  float delta = value - this->average_;
+  this->average_ += delta / this->count_;
+  this->m2_ += delta * (value - this->average_);
+}
+
+void ADE7880Statistics::publish() {
+  // An interval without samples has no known value
+  bool valid = this->count_ > 0;
+  if(this->min != nullptr) {
+    this->min->publish_state(valid ? this->low_ : NAN);
+  }
+  if(this->max != nullptr) {
+    this->max->publish_state(valid ? this->high_ : NAN);
+  }
+  if(this->mean != nullptr) {
+    this->mean->publish_state(valid ? this->average_ : NAN);
+  }
+  if(this->stddev != nullptr) {
+    this->stddev->publish_state(valid ? std::sqrt(this->m2_ / this->count_) : NAN);
+  }
+  this->count_ = 0;
+  this->average_ = 0.0f;
+  this->m2_ = 0.0f;
+}
+
+void ADE7880::setup_events_() {
+  this->peaks_enabled_ = false;
+  this->statistics_ = 0;
+  for(PowerChannel *channel : {this->channel_a_, this->channel_b_, this->channel_c_}) {
+    if(channel != nullptr && (channel->peak_current != nullptr || channel->peak_voltage != nullptr)) {
+      this->peaks_enabled_ = true;
+    }
+    for(uint8_t q=0; q<STATISTICS_COUNT && channel != nullptr; q++) {
+      const ADE7880Statistics &statistics = channel->statistics[q];
+      if(statistics.min != nullptr || statistics.max != nullptr || statistics.mean != nullptr ||
+         statistics.stddev != nullptr) {
+        this->statistics_ |= 1 << q;
+      }
+    }
+  }
+  this->mask1_ = 0;
+  if(this->sag_level_ > 0.0f) {
+    this->mask1_ |= MASK1_SAG;
+  }
+  if(this->overvoltage_level_ > 0.0f) {
+    this->mask1_ |= MASK1_OV;
+  }
+  if(this->overcurrent_level_ > 0.0f) {
+    this->mask1_ |= MASK1_OI;
+  }
+  if(this->peak_cycles_ > 0 || this->peaks_enabled_) {
+    this->mask1_ |= MASK1_PKI | MASK1_PKV;
+  }
+  PowerChannel *channels[3] = {this->channel_a_, this->channel_b_, this->channel_c_};
+  for(uint8_t i=0; i<3; i++) {
+    if(channels[i] == nullptr || channels[i]->phase_loss == nullptr) {
+      continue;
+    }
+    this->mask1_ |= MASK1_ZXTOVA << i;
+    if(channels[i]->phase_lost_) {
+      // Still lost until a zero crossing says otherwise
+      this->mask1_ |= MASK1_ZXVA << i;
+    }
+  }
+  if(this->sequence_error_sensor_ != nullptr) {
+    this->mask1_ |= MASK1_SEQERR;
+  }
+  if(this->channel_n_ != nullptr && this->channel_n_->current_mismatch != nullptr) {
+    this->mask1_ |= MASK1_MISMTCH;
+  }
+
+  this->direction_mask0_ = 0;
+  for(uint8_t i=0; i<3; i++) {
+    if(channels[i] != nullptr && channels[i]->reverse_power != nullptr) {
+      this->direction_mask0_ |= MASK0_REVAPA << i;
+    }
+  }
+  if(this->total_reverse_power_sensor_ != nullptr) {
+    // CF1 sums all phases, see the TERMSEL1 bits of COMPMODE
+    this->direction_mask0_ |= MASK0_REVPSUM1;
+  }
+  this->energy_sign_mask0_ = 0;
+  for(uint8_t i=0; i<3 && this->energy_mode_ != ENERGY_LINE_CYCLE; i++) {
+    // Energy read at a sign change is split by direction, independent of the direction sensors
+    if(has_active_energy_sensors(channels[i])) {
+      this->energy_sign_mask0_ |= MASK0_REVAPA << i;
+    }
+    if(has_reactive_energy_sensors(channels[i])) {
+      this->energy_sign_mask0_ |= MASK0_REVFRPA << i;
+    }
+  }
+  this->reverse_mask0_ = this->direction_mask0_ | this->energy_sign_mask0_;
+}
+
+void ADE7880::publish_direction_(uint32_t phsign) {
+  PowerChannel *channels[3] = {this->channel_a_, this->channel_b_, this->channel_c_};
+  for(uint8_t i=0; i<3; i++) {
+    if(channels[i] != nullptr && channels[i]->reverse_power != nullptr) {
+      channels[i]->reverse_power->publish_state(phsign & (PHSIGN_AWSIGN << i));
+    }
+  }
+  if(this->total_reverse_power_sensor_ != nullptr) {
+    this->total_reverse_power_sensor_->publish_state(phsign & PHSIGN_SUM1SIGN);
+  }
+}
+
+void ADE7880::rearm_events_() {
+  // A flag still enabled had no event since the last update
+  uint32_t fired = 0;
+  if(this->sequence_error_sensor_ != nullptr) {
+    if(this->mask1_ & MASK1_SEQERR) {
+      this->sequence_error_sensor_->publish_state(false);
+    }
+    else {
+      fired |= MASK1_SEQERR;
+    }
+  }
+  if(this->channel_n_ != nullptr && this->channel_n_->current_mismatch != nullptr) {
+    if(this->mask1_ & MASK1_MISMTCH) {
+      this->channel_n_->current_mismatch->publish_state(false);
+    }
+    else {
+      fired |= MASK1_MISMTCH;
+    }
+  }
+  if(!fired) {
+    return;
+  }
+  // Re-arm with clean flags, a persisting condition fires again right away
+  this->ade_queue_write_(ADE7880_STATUS1, fired);
+  this->ade_queue_write_(ADE7880_MASK1, this->mask1_ | fired);
+  if(this->ade_commit_() == i2c::ERROR_OK) {
+    this->mask1_ |= fired;
+  }
+}
+
+void ADE7880::select_angles_(uint16_t anglesel) {
+  this->compmode_ = (this->compmode_ & ~COMPMODE_ANGLESEL_11) | anglesel;
+  ADE7880Block *angle = &this->blocks_[4];
+  PowerChannel *channels[3] = {this->channel_a_, this->channel_b_, this->channel_c_};
+  for(uint8_t i=0; i<3; i++) {
+    if(channels[i] != nullptr) {
+      angle->sensors[i] = anglesel == COMPMODE_ANGLESEL_01 ? channels[i]->voltage_angle : channels[i]->current_angle;
+    }
+  }
+}
+
+void ADE7880::publish_event_(const char *event, uint8_t phase, uint32_t time, const char *detail) {
+  // The edge time in us wraps after 71 minutes, the state carries it as ms since boot
+  uint32_t at = millis() - (micros() - time) / 1000;
+  char state[64];
+  if(detail != nullptr) {
+    snprintf(state, sizeof(state), "%s %c %s at %u ms", event, "ABCN"[phase], detail, (unsigned)at);
+  }
+  else {
+    snprintf(state, sizeof(state), "%s %c at %u ms", event, "ABCN"[phase], (unsigned)at);
+  }
+  ESP_LOGD(TAG, "Event %s", state);
+  if(this->event_sensor_ != nullptr) {
+    this->event_sensor_->publish_state(state);
+  }
+}
+
+uint32_t ADE7880::mask0_active_() const {
+  uint32_t mask0 = this->mask0_;
+  if(this->harmonic_step_ != ADE7880_HARMONIC_IDLE) {
+    mask0 |= MASK0_HREADY;
+  }
+  if(this->capturing_) {
+    mask0 |= MASK0_DREADY;
+  }
+  return mask0;
+}
+
+void ADE7880::setup_capture_() {
+  this->capture_width_ = 0;
+  for(uint8_t i=0; i<ADE7880_WAVEFORM_CHANNELS; i++) {
+    if(this->capture_channels_ & (1 << i)) {
+      this->capture_regs_[this->capture_width_++] = i;
+    }
+  }
+  if(this->capture_samples_ == 0 || this->capture_width_ == 0) {
+    return;
+  }
+  this->capture_span_ = this->capture_regs_[this->capture_width_ - 1] - this->capture_regs_[0] + 1;
+  this->capture_values_.resize(this->capture_samples_ * this->capture_width_);
+  this->capture_times_.resize(this->capture_samples_);
+}
+
+bool ADE7880::start_capture() {
+  if(this->capture_values_.empty()) {
+    ESP_LOGW(TAG, "Waveform capture not configured");
+    return false;
+  }
+  if(this->capturing_ || !(this->setup_state_ & INIT_DONE)) {
+    return false;
+  }
+  this->capture_count_ = 0;
+  this->capture_logged_ = 0;
+  this->capturing_ = true;
+  // DREADY is only serviced from loop(), which otherwise runs every 16 ms
+  this->high_freq_.start();
+  // A stale DREADY would date the first sample before the start
+  this->ade_queue_write_(ADE7880_STATUS0, STATUS0_DREADY);
+  this->ade_queue_write_(ADE7880_MASK0, this->mask0_active_());
+  if(this->ade_commit_() != i2c::ERROR_OK) {
+    ESP_LOGE(TAG, "Failed to start waveform capture");
+    this->capturing_ = false;
+    this->high_freq_.stop();
+    return false;
+  }
+  return true;
+}
+
+void ADE7880::store_capture_(const uint32_t *samples, uint32_t time) {
+  if(this->capture_count_ == 0) {
+    this->capture_start_ = time;
+  }
+  // IAWV..VCWV are 24-bit signed, the same shift holds for all of them
+  static constexpr uint8_t shift = ade_reg_codec(ADE7880_IAWV).shift;
+  int32_t *values = &this->capture_values_[this->capture_count_ * this->capture_width_];
+  for(uint8_t i=0; i<this->capture_width_; i++) {
+    values[i] = ade_reg_decode(samples[this->capture_regs_[i] - this->capture_regs_[0]], shift);
+  }
+  this->capture_times_[this->capture_count_] = time - this->capture_start_;
+
+  if(++this->capture_count_ == this->capture_samples_) {
+    // DREADY is masked again in the transaction that clears the last one
+    this->capturing_ = false;
+    this->high_freq_.stop();
+    this->ade_queue_write_(ADE7880_MASK0, this->mask0_active_());
+    ESP_LOGD(TAG, "Waveform capture done, %u samples in %u us", this->capture_count_,
+             this->capture_times_[this->capture_count_ - 1]);
+  }
+}
+
+float ADE7880::get_capture_value(uint16_t sample, uint8_t channel) const {
+  // Waveform samples share the LSB weight of xIRMS and xVRMS, INWV that of NIRMS
+  float scale = this->capture_regs_[channel] < ADE7880_VAWV - ADE7880_IAWV ? CURRENT_SCALE : VOLTAGE_SCALE;
+  return this->capture_values_[sample * this->capture_width_ + channel] * scale;
+}
+
+void ADE7880::log_capture_() {
+  static const char *const NAMES[ADE7880_WAVEFORM_CHANNELS] = {"IA", "IB", "IC", "IN", "VA", "VB", "VC"};
+  char row[96];
+  if(this->capture_logged_ == 0) {
+    int pos = snprintf(row, sizeof(row), "us");
+    for(uint8_t i=0; i<this->capture_width_; i++) {
+      pos += snprintf(row + pos, sizeof(row) - pos, ",%s", NAMES[this->capture_regs_[i]]);
+    }
+    ESP_LOGI(TAG, "Waveform capture of %u samples:", this->capture_count_);
+    ESP_LOGI(TAG, "%s", row);
+  }
+  // A few rows per loop() keep the logger from stalling the main loop
+  uint16_t end = this->capture_logged_ + 8;
+  if(end > this->capture_count_) {
+    end = this->capture_count_;
+  }
+  for(uint16_t n=this->capture_logged_; n<end; n++) {
+    int pos = snprintf(row, sizeof(row), "%u", this->capture_times_[n]);
+    for(uint8_t i=0; i<this->capture_width_; i++) {
+      pos += snprintf(row + pos, sizeof(row) - pos, ",%.3f", this->get_capture_value(n, i));
+    }
+    ESP_LOGI(TAG, "%s", row);
+  }
+  this->capture_logged_ = end;
+}
 
 } // namespace ade7880
 } // namespace esphome
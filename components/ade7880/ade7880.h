@@ -1,22 +1,69 @@
 #pragma once
 
+#include <utility>
+#include <vector>
+
 #include "esphome/core/component.h"
 #include "esphome/core/hal.h"
+#include "esphome/core/helpers.h"
+#include "esphome/core/preferences.h"
+#include "esphome/components/binary_sensor/binary_sensor.h"
 #include "esphome/components/i2c/i2c.h"
 #include "esphome/components/sensor/sensor.h"
+#include "esphome/components/text_sensor/text_sensor.h"
 
 namespace esphome {
 namespace ade7880 {
 
+// Harmonics tracked in parallel by the HX, HY and HZ computations
+static const uint8_t ADE7880_HARMONIC_SLOTS = 3;
+static const uint8_t ADE7880_HARMONIC_IDLE = 0xFF;
+
 struct NeutralChannel {
     void set_current(sensor::Sensor *current) { this->current = current; }
+    void set_current_sum_sample(sensor::Sensor *current_sum_sample) { this->current_sum_sample = current_sum_sample; }
+    void set_current_mismatch(binary_sensor::BinarySensor *current_mismatch) { this->current_mismatch = current_mismatch; }
+    void set_mismatch_level(float mismatch_level) { this->mismatch_level = mismatch_level; }
 
     void set_current_gain_calibration(int32_t val) { this->current_gain_calibration = val; }
 
     sensor::Sensor *current{nullptr};
+    // ISUM, one instantaneous sample of IAWV + IBWV + ICWV read with the rms block. Not an rms
+    // value, it swings with the line phase.
+    sensor::Sensor *current_sum_sample{nullptr};
+    // MISMTCH: ISUM and the neutral current sample differ by more than mismatch_level
+    binary_sensor::BinarySensor *current_mismatch{nullptr};
+    float mismatch_level{0.0f};  // rms of a sine
     int32_t current_gain_calibration{0};
 };
 
+// Quantities with streaming statistics, index into PowerChannel::statistics
+enum ADE7880StatisticsQuantity : uint8_t {
+  STATISTICS_VOLTAGE = 0,
+  STATISTICS_CURRENT,
+  STATISTICS_ACTIVE_POWER,
+  STATISTICS_COUNT,
+};
+
+// Minimum, maximum, mean and standard deviation of one second samples, taken with the LENERGY
+// service or by a timer in half full mode, published and restarted on update. Welford's method keeps them in constant memory.
+struct ADE7880Statistics {
+    void add(float value);
+    void publish();
+
+    sensor::Sensor *min{nullptr};
+    sensor::Sensor *max{nullptr};
+    sensor::Sensor *mean{nullptr};
+    sensor::Sensor *stddev{nullptr};
+
+    uint32_t count_{0};
+    float low_{0.0f};
+    float high_{0.0f};
+    float average_{0.0f};
+    // Sum of squared differences from the running mean
+    float m2_{0.0f};
+};
+
 struct PowerChannel {
     void set_voltage(sensor::Sensor *voltage) { this->voltage = voltage; }
     void set_current(sensor::Sensor *current) { this->current = current; }
@@ -28,6 +75,40 @@ struct PowerChannel {
 
     void set_forward_active_energy(sensor::Sensor *forward_active_energy) { this->forward_active_energy = forward_active_energy; }
     void set_reverse_active_energy(sensor::Sensor *reverse_active_energy) { this->reverse_active_energy = reverse_active_energy; }
+    void set_forward_reactive_energy(sensor::Sensor *forward_reactive_energy) { this->forward_reactive_energy = forward_reactive_energy; }
+    void set_reverse_reactive_energy(sensor::Sensor *reverse_reactive_energy) { this->reverse_reactive_energy = reverse_reactive_energy; }
+
+    void set_fundamental_voltage(sensor::Sensor *fundamental_voltage) { this->fundamental_voltage = fundamental_voltage; }
+    void set_fundamental_current(sensor::Sensor *fundamental_current) { this->fundamental_current = fundamental_current; }
+    void set_fundamental_active_power(sensor::Sensor *fundamental_active_power) { this->fundamental_active_power = fundamental_active_power; }
+    void set_fundamental_apparent_power(sensor::Sensor *fundamental_apparent_power) { this->fundamental_apparent_power = fundamental_apparent_power; }
+    void set_fundamental_power_factor(sensor::Sensor *fundamental_power_factor) { this->fundamental_power_factor = fundamental_power_factor; }
+
+    void set_peak_current(sensor::Sensor *peak_current) { this->peak_current = peak_current; }
+    void set_peak_voltage(sensor::Sensor *peak_voltage) { this->peak_voltage = peak_voltage; }
+    void set_statistics(uint8_t quantity, sensor::Sensor *min, sensor::Sensor *max, sensor::Sensor *mean,
+                        sensor::Sensor *stddev) {
+        this->statistics[quantity].min = min;
+        this->statistics[quantity].max = max;
+        this->statistics[quantity].mean = mean;
+        this->statistics[quantity].stddev = stddev;
+    }
+
+    void set_sag_events(sensor::Sensor *sag_events) { this->sag_events = sag_events; }
+    void set_overvoltage_events(sensor::Sensor *overvoltage_events) { this->overvoltage_events = overvoltage_events; }
+    void set_overcurrent_events(sensor::Sensor *overcurrent_events) { this->overcurrent_events = overcurrent_events; }
+
+    void set_current_angle(sensor::Sensor *current_angle) { this->current_angle = current_angle; }
+    void set_voltage_angle(sensor::Sensor *voltage_angle) { this->voltage_angle = voltage_angle; }
+    void set_phase_loss(binary_sensor::BinarySensor *phase_loss) { this->phase_loss = phase_loss; }
+    void set_reverse_power(binary_sensor::BinarySensor *reverse_power) { this->reverse_power = reverse_power; }
+
+    void set_voltage_thd(sensor::Sensor *voltage_thd) { this->voltage_thd = voltage_thd; }
+    void set_current_thd(sensor::Sensor *current_thd) { this->current_thd = current_thd; }
+    void set_voltage_harmonic(uint8_t slot, sensor::Sensor *voltage_harmonic) { this->voltage_harmonics[slot] = voltage_harmonic; }
+    void set_current_harmonic(uint8_t slot, sensor::Sensor *current_harmonic) { this->current_harmonics[slot] = current_harmonic; }
+    void set_voltage_spectrum(text_sensor::TextSensor *voltage_spectrum) { this->voltage_spectrum = voltage_spectrum; }
+    void set_current_spectrum(text_sensor::TextSensor *current_spectrum) { this->current_spectrum = current_spectrum; }
 
     void set_voltage_gain_calibration(int32_t val) { this->voltage_gain_calibration = val; }
     void set_current_gain_calibration(int32_t val) { this->current_gain_calibration = val; }
@@ -45,6 +126,40 @@ struct PowerChannel {
 
     sensor::Sensor *forward_active_energy{nullptr};
     sensor::Sensor *reverse_active_energy{nullptr};
+    sensor::Sensor *forward_reactive_energy{nullptr};
+    sensor::Sensor *reverse_reactive_energy{nullptr};
+
+    // Fundamental quantities and reactive power come from the harmonic engine
+    sensor::Sensor *fundamental_voltage{nullptr};
+    sensor::Sensor *fundamental_current{nullptr};
+    sensor::Sensor *fundamental_active_power{nullptr};
+    sensor::Sensor *fundamental_apparent_power{nullptr};
+    sensor::Sensor *fundamental_power_factor{nullptr};
+
+    // Largest IPEAK/VPEAK attributed to the phase since the last update
+    sensor::Sensor *peak_current{nullptr};
+    sensor::Sensor *peak_voltage{nullptr};
+
+    // Power quality event counters, published from the IRQ1 path
+    sensor::Sensor *sag_events{nullptr};
+    sensor::Sensor *overvoltage_events{nullptr};
+    sensor::Sensor *overcurrent_events{nullptr};
+
+    // ANGLEx delays in degrees: from the phase voltage to its current, and from the voltage of
+    // the preceding phase (C for A) to the phase voltage
+    sensor::Sensor *current_angle{nullptr};
+    sensor::Sensor *voltage_angle{nullptr};
+    // Set on a ZXTOx zero-crossing timeout, cleared by the next voltage zero crossing
+    binary_sensor::BinarySensor *phase_loss{nullptr};
+    // Active power sign from PHSIGN, updated on the REVAPx interrupt
+    binary_sensor::BinarySensor *reverse_power{nullptr};
+
+    sensor::Sensor *voltage_thd{nullptr};
+    sensor::Sensor *current_thd{nullptr};
+    sensor::Sensor *voltage_harmonics[ADE7880_HARMONIC_SLOTS]{nullptr};
+    sensor::Sensor *current_harmonics[ADE7880_HARMONIC_SLOTS]{nullptr};
+    text_sensor::TextSensor *voltage_spectrum{nullptr};
+    text_sensor::TextSensor *current_spectrum{nullptr};
 
     int32_t voltage_gain_calibration{0};
     int32_t current_gain_calibration{0};
@@ -52,24 +167,148 @@ struct PowerChannel {
     int32_t phase_angle_calibration{0};
     int32_t total_power_gain_calibration{0};
 
-    int32_t duwh_delta_{0};
-    int32_t dmwh_{0};
-    int32_t dmwh_forward_{0};
-    int32_t dmwh_reverse_{0};
+    // Energy in xWATTHR LSB, converted only when published
+    uint64_t watthr_forward_{0};
+    uint64_t watthr_reverse_{0};
+    // Fundamental reactive energy in xFVARHR LSB
+    uint64_t varhr_forward_{0};
+    uint64_t varhr_reverse_{0};
+
+    // Last xWATTHR and xFVARHR values in running total energy mode
+    uint32_t watthr_total_{0};
+    uint32_t varhr_total_{0};
+    bool watthr_primed_{false};
+
+    // Raw peak maxima of the update interval, 0 when the phase never held the peak
+    uint32_t ipeak_max_{0};
+    uint32_t vpeak_max_{0};
+
+    uint32_t sag_count_{0};
+    uint32_t overvoltage_count_{0};
+    uint32_t overcurrent_count_{0};
+    // SAG is raised on entering and on leaving a sag, the state toggles with each event
+    bool in_sag_{false};
+    uint32_t sag_start_{0};
+    bool phase_lost_{false};
+    // Apparent power below the no-load level at the last update
+    bool idle_{false};
+
+    ADE7880Statistics statistics[STATISTICS_COUNT];
+
+    // Harmonic distortion in % per swept index, NAN until measured
+    std::vector<float> voltage_spectrum_;
+    std::vector<float> current_spectrum_;
 };
 
+// Maximum number of consecutive registers of a measurement block
+static const uint8_t ADE7880_MAX_BURST = 8;
+// Longest single burst read, the harmonic engine results FVRMS..HZIHD
+static const uint8_t ADE7880_MAX_BURST_READ = 32;
+
+// Consecutive measurement registers read with a single burst
+struct ADE7880Block {
+  uint16_t reg{0};
+  uint8_t count{0};
+  sensor::Sensor *sensors[ADE7880_MAX_BURST]{nullptr};
+  // Register codecs resolved by setup_blocks_(), the physical value is scale * raw, or
+  // scale / raw from the register at reciprocal_from on
+  uint8_t shifts[ADE7880_MAX_BURST]{0};
+  float scales[ADE7880_MAX_BURST]{0.0f};
+  uint8_t reciprocal_from{ADE7880_MAX_BURST};
+  // Registers that only carry load quantities of a phase, skipped while the phase has no load
+  uint8_t load_slots[3]{0};
+  uint8_t idle{0};
+  // Update group of each register, 0 follows update(), see set_sensor_update_interval()
+  uint8_t groups[ADE7880_MAX_BURST]{0};
+  // Registers published by the pass in progress
+  uint8_t due{0};
+  // Registers read by the pass in progress, count up to the last due one
+  uint8_t read_count{0};
+  uint32_t values[ADE7880_MAX_BURST]{0};
+  i2c::ErrorCode err{i2c::ERROR_OK};
+  // Duration of the last read in us, decides whether the block still fits a slice
+  uint32_t read_time{0};
+};
+
+static const uint8_t ADE7880_BLOCK_COUNT = 5;
+// Group 0 follows update(), the others are sensors with their own update_interval
+static const uint8_t ADE7880_MAX_GROUPS = 8;
+
+// Instantaneous waveform registers IAWV, IBWV, ICWV, INWV, VAWV, VBWV and VCWV
+static const uint8_t ADE7880_WAVEFORM_CHANNELS = 7;
+
+// Queued register access, a write when count is 0
+struct ADE7880Op {
+  uint16_t reg;
+  uint8_t count;
+  uint32_t value;
+  uint32_t *values;
+};
+
+// Largest batch queued by a caller, the first harmonic step: HX, HY, HZ, HCONFIG, STATUS0
+// and MASK0
+static const uint8_t ADE7880_MAX_OPS = 6;
+
+// CHECKSUM values learned by the integrity monitor besides the one recorded after init
+static const uint8_t ADE7880_KNOWN_CHECKSUMS = 4;
+
+// IRQ1 edges queued between the interrupt handler and loop(), a power of two
+static const uint8_t ADE7880_EVENT_QUEUE_SIZE = 8;
+
 // Store data in a class that doesn't use multiple-inheritance (no vtables in flash!)
 struct ADE7880Store {
   uint8_t irq0_state{0};
   uint8_t skip_cycles{2};
 
+  // Lock-free single producer (irq1_int) single consumer (loop) ring of IRQ1 edge
+  // timestamps in us. The head is only written by the interrupt, the tail only by loop().
+  // All of it is volatile so the slot store isn't reordered after the head that publishes it.
+  volatile uint32_t irq1_times[ADE7880_EVENT_QUEUE_SIZE]{0};
+  volatile uint8_t irq1_head{0};
+  volatile uint8_t irq1_tail{0};
+  volatile uint8_t irq1_dropped{0};
+
   static void irq0_int(ADE7880Store *store);
+  static void irq1_int(ADE7880Store *store);
+};
+
+// Energy accumulators persisted in preferences, indexed by phase
+struct ADE7880SavedEnergy {
+  uint64_t forward[3];
+  uint64_t reverse[3];
+  uint64_t reactive_forward[3];
+  uint64_t reactive_reverse[3];
 };
 
 enum ADE7880SetupPhase {
   RESET_BEGIN = 1 << 0,
   RESET_DONE = 1 << 1,
   INIT_DONE = 1 << 2,
+  // Watchdog recovery without a reset, CHECKSUM decides whether the configuration survived
+  WARM_BEGIN = 1 << 3,
+  WARM_RESTORED = 1 << 4,
+};
+
+// CHECKSUM with the registers it covers that the driver changes at runtime. The other covered
+// registers (gains, offsets, Gain, CFMODE, CONFIG, ACCMODE, LCYCMODE...) only change with
+// ade_init_(), which records a new CHECKSUM. HX/HY/HZ and HCONFIG aren't covered.
+struct ADE7880Checksum {
+  uint32_t checksum;
+  uint32_t mask0;
+  uint32_t mask1;
+  uint16_t compmode;
+};
+
+enum ADE7880VerifyMode : uint8_t {
+  VERIFY_PER_REGISTER = 0,
+  VERIFY_PER_BATCH,
+  VERIFY_NONE,
+};
+
+enum ADE7880EnergyMode : uint8_t {
+  ENERGY_LINE_CYCLE = 0,
+  ENERGY_RUNNING_TOTAL,
+  ENERGY_HALF_FULL,
 };
 
 class ADE7880 : public i2c::I2CDevice, public PollingComponent {
@@ -78,8 +317,39 @@ class ADE7880 : public i2c::I2CDevice, public PollingComponent {
   void set_irq1_pin(InternalGPIOPin *irq1_pin) { this->irq1_pin_ = irq1_pin; }
   void set_reset_pin(InternalGPIOPin *reset_pin) { this->reset_pin_ = reset_pin; }
   void set_frequency(float frequency) { this->frequency_ = frequency; }
+  void set_nominal_voltage(float nominal_voltage) { this->nominal_voltage_ = nominal_voltage; }
   void set_watchdog_threshold(uint16_t watchdog_threshold) { this->watchdog_threshold_ = watchdog_threshold; }
   void set_failure_threshold(uint8_t failure_threshold) { this->failure_threshold_ = failure_threshold; }
+  void set_verify_mode(ADE7880VerifyMode verify_mode) { this->verify_mode_ = verify_mode; }
+  void set_energy_mode(ADE7880EnergyMode energy_mode) { this->energy_mode_ = energy_mode; }
+  void set_slice_budget(uint32_t slice_budget) { this->slice_budget_ = slice_budget; }
+  void set_slice_duration_sensor(sensor::Sensor *slice_duration_sensor) { this->slice_duration_sensor_ = slice_duration_sensor; }
+  void set_sensor_update_interval(sensor::Sensor *sensor, uint32_t interval) {
+    this->sensor_intervals_.emplace_back(sensor, interval);
+  }
+  void set_integrity_interval(uint32_t integrity_interval) { this->integrity_interval_ = integrity_interval; }
+  void set_integrity_events_sensor(sensor::Sensor *integrity_events_sensor) { this->integrity_events_sensor_ = integrity_events_sensor; }
+  void set_restore_energy(bool restore_energy) { this->restore_energy_ = restore_energy; }
+  void set_flush_interval(uint32_t flush_interval) { this->flush_interval_ = flush_interval; }
+  void set_flush_min_interval(uint32_t flush_min_interval) { this->flush_min_interval_ = flush_min_interval; }
+  void set_flush_energy_delta(float flush_energy_delta) { this->flush_energy_delta_ = flush_energy_delta; }
+  void set_flush_on_shutdown(bool flush_on_shutdown) { this->flush_on_shutdown_ = flush_on_shutdown; }
+  void set_harmonic_index(uint8_t slot, uint8_t index) { this->harmonic_indexes_[slot] = index; }
+  void set_sweep_indexes(const std::vector<uint8_t> &sweep_indexes) { this->sweep_indexes_ = sweep_indexes; }
+  void set_harmonic_steps_per_update(uint8_t steps) { this->harmonic_steps_per_update_ = steps; }
+  void set_sag_level(float sag_level) { this->sag_level_ = sag_level; }
+  void set_sag_cycles(uint8_t sag_cycles) { this->sag_cycles_ = sag_cycles; }
+  void set_overvoltage_level(float overvoltage_level) { this->overvoltage_level_ = overvoltage_level; }
+  void set_overcurrent_level(float overcurrent_level) { this->overcurrent_level_ = overcurrent_level; }
+  void set_peak_cycles(uint8_t peak_cycles) { this->peak_cycles_ = peak_cycles; }
+  void set_event_sensor(text_sensor::TextSensor *event_sensor) { this->event_sensor_ = event_sensor; }
+  void set_zero_crossing_timeout(uint32_t zero_crossing_timeout) { this->zero_crossing_timeout_ = zero_crossing_timeout; }
+  void set_sequence_error_sensor(binary_sensor::BinarySensor *sequence_error_sensor) { this->sequence_error_sensor_ = sequence_error_sensor; }
+  void set_no_load_level(float no_load_level) { this->no_load_level_ = no_load_level; }
+  void set_total_reverse_power_sensor(binary_sensor::BinarySensor *total_reverse_power_sensor) { this->total_reverse_power_sensor_ = total_reverse_power_sensor; }
+  void set_capture_samples(uint16_t capture_samples) { this->capture_samples_ = capture_samples; }
+  void set_capture_channels(uint8_t capture_channels) { this->capture_channels_ = capture_channels; }
+  void set_capture_log(bool capture_log) { this->capture_log_ = capture_log; }
   void set_channel_n(NeutralChannel *channel_n) { this->channel_n_ = channel_n; }
   void set_channel_a(PowerChannel *channel_a) { this->channel_a_ = channel_a; }
   void set_channel_b(PowerChannel *channel_b) { this->channel_b_ = channel_b; }
@@ -93,41 +363,244 @@ class ADE7880 : public i2c::I2CDevice, public PollingComponent {
 
   void dump_config() override;
 
+  void on_shutdown() override;
+
   float get_setup_priority() const override { return setup_priority::DATA; }
 
+  // Waveform capture on demand, false while a capture runs or none is configured
+  bool start_capture();
+  bool is_capturing() const { return this->capturing_; }
+  uint16_t get_capture_count() const { return this->capture_count_; }
+  // Selected channels in register order IA, IB, IC, IN, VA, VB, VC
+  uint8_t get_capture_width() const { return this->capture_width_; }
+  // Time of a sample in us after the first one
+  uint32_t get_capture_time(uint16_t sample) const { return this->capture_times_[sample]; }
+  // Sample of the n-th selected channel in A or V
+  float get_capture_value(uint16_t sample, uint8_t channel) const;
+
  protected:
   ADE7880Store store_;
   InternalGPIOPin *irq0_pin_{nullptr};
   InternalGPIOPin *irq1_pin_{nullptr};
   InternalGPIOPin *reset_pin_{nullptr};
   float frequency_;
+  // Line voltage U_n of Equation 22, sets VLEVEL
+  float nominal_voltage_{230.0f};
   NeutralChannel *channel_n_{nullptr};
   PowerChannel *channel_a_{nullptr};
   PowerChannel *channel_b_{nullptr};
   PowerChannel *channel_c_{nullptr};
 
+  ADE7880Block blocks_[ADE7880_BLOCK_COUNT];
+  // Next block to publish, ADE7880_BLOCK_COUNT when idle
+  uint8_t block_index_{ADE7880_BLOCK_COUNT};
+  // Multi-rate reads: loop() starts a pass for the groups that are due, update() adds group 0.
+  // All groups due at once are read with one burst per block.
+  std::vector<std::pair<sensor::Sensor *, uint32_t>> sensor_intervals_;
+  uint32_t group_intervals_[ADE7880_MAX_GROUPS]{0};
+  uint32_t group_next_[ADE7880_MAX_GROUPS]{0};
+  uint8_t group_count_{1};
+  uint8_t pass_groups_{0};
+  // Groups waiting for the pass in progress
+  uint8_t pending_groups_{0};
+  uint32_t slice_budget_{2000};
+  uint32_t max_slice_duration_{0};
+  sensor::Sensor *slice_duration_sensor_{nullptr};
+
   uint8_t setup_state_{0};
   uint32_t watchdog_{0};
   uint16_t watchdog_threshold_{5000};
   uint8_t failure_counter_{0};
   uint8_t failure_threshold_{5};
+  ADE7880VerifyMode verify_mode_{VERIFY_PER_REGISTER};
+  ADE7880EnergyMode energy_mode_{ENERGY_LINE_CYCLE};
+  // CHECKSUM after the last good init, checksum 0 when unknown. It covers MASK0, MASK1 and COMPMODE,
+  // their values at the time it was read are restored before comparing.
+  ADE7880Checksum checksum_{};
+  // Integrity monitor: CHECKSUM of other MASK0, MASK1 and COMPMODE states is learned once their
+  // configuration reads back intact, 0 disables the periodic check
+  uint32_t integrity_interval_{0};
+  ADE7880Checksum known_checksums_[ADE7880_KNOWN_CHECKSUMS]{};
+  uint8_t known_checksum_next_{0};
+  bool integrity_repaired_{false};
+  uint32_t integrity_events_{0};
+  sensor::Sensor *integrity_events_sensor_{nullptr};
+
+  // Energy persistence, flushed from update() when dirty
+  bool restore_energy_{false};
+  uint32_t flush_interval_{3600000};
+  uint32_t flush_min_interval_{600000};
+  float flush_energy_delta_{0.0f};  // Wh, 0 disables early flushes
+  bool flush_on_shutdown_{true};
+  ESPPreferenceObject energy_pref_;
+  uint32_t last_flush_{0};
+  uint64_t flushed_watthr_{0};  // Sum of the active energy accumulators at the last flush
+  uint64_t flushed_varhr_{0};   // Sum of the reactive energy accumulators at the last flush
+
+  // Harmonic analysis in steps of one phase and up to three indexes (a group). Group 0 holds
+  // the fixed harmonic sensors when present, the swept indexes follow in groups of three.
+  uint8_t harmonic_indexes_[ADE7880_HARMONIC_SLOTS]{3, 5, 7};
+  // Number of fixed HX/HY/HZ result sets read
+  uint8_t harmonic_slots_{0};
+  bool harmonics_enabled_{false};
+  // Results are read from FVRMS instead of VTHD to include the fundamental quantities
+  bool fundamental_enabled_{false};
+  // xFVARHR are read in the same burst as xWATTHR
+  bool reactive_energy_enabled_{false};
+  std::vector<uint8_t> sweep_indexes_;
+  uint8_t harmonic_groups_{0};
+  uint8_t harmonic_steps_per_update_{3};
+  uint8_t harmonic_steps_left_{0};
+  // Next step to consider, step = group * 3 + phase
+  uint8_t harmonic_cursor_{0};
+  // Step under analysis, ADE7880_HARMONIC_IDLE when idle
+  uint8_t harmonic_step_{ADE7880_HARMONIC_IDLE};
+  // Group currently written to HX/HY/HZ
+  uint8_t harmonic_loaded_group_{ADE7880_HARMONIC_IDLE};
+  // MASK0 without HREADY, which is only enabled during a harmonic sweep
+  uint32_t mask0_{0};
+  // REVAPx/REVPSUM1 sign change interrupts of the direction sensors, PHSIGN is read with STATUS0
+  uint32_t direction_mask0_{0};
+  // REVAPx/REVFRPx of the phases with energy sensors outside line cycle mode, each reads the energy
+  uint32_t energy_sign_mask0_{0};
+  // All sign change interrupts, direction_mask0_ | energy_sign_mask0_
+  uint32_t reverse_mask0_{0};
+  binary_sensor::BinarySensor *total_reverse_power_sensor_{nullptr};
+  // Apparent power in VA below which a phase counts as idle, 0 disables no-load detection
+  float no_load_level_{0.0f};
+  // COMPMODE as written by ade_init_(), ANGLESEL alternates when both angle kinds are used
+  uint16_t compmode_{0};
+  // ANGLESEL selected at init, voltage to current angles unless only voltage angles are used
+  uint16_t anglesel_{0};
+  bool angles_alternate_{false};
+
+  // Power quality thresholds as rms of a sine, 0 disables the event
+  float sag_level_{0.0f};
+  uint8_t sag_cycles_{2};
+  float overvoltage_level_{0.0f};
+  float overcurrent_level_{0.0f};
+  // PKI/PKV events after PEAKCYC half line cycles, 0 disables them
+  uint8_t peak_cycles_{0};
+  // Peak sensors configured. IPEAK/VPEAK track all phases, they are recorded with each PKI
+  // interrupt and read along with the rms block.
+  bool peaks_enabled_{false};
+  // Quantities with statistics on any phase, one bit each. Their registers are sampled once
+  // a second.
+  uint8_t statistics_{0};
+  text_sensor::TextSensor *event_sensor_{nullptr};
+  // ZXTOUT in ms, a phase without voltage zero crossings for this long is lost
+  uint32_t zero_crossing_timeout_{100};
+  binary_sensor::BinarySensor *sequence_error_sensor_{nullptr};
+  // Interrupts currently enabled. ZXVx is only enabled while phase x is lost. SEQERR and
+  // MISMTCH are disabled from their first event until the next update, they repeat while
+  // the condition lasts.
+  uint32_t mask1_{0};
+
+  // Bit n of capture_channels_ selects register IAWV + n. One burst per DREADY covers the
+  // first to the last selected register.
+  uint16_t capture_samples_{0};
+  uint8_t capture_channels_{0};
+  bool capture_log_{true};
+  uint8_t capture_regs_[ADE7880_WAVEFORM_CHANNELS]{0};
+  uint8_t capture_width_{0};
+  uint8_t capture_span_{0};
+  // Allocated once in setup(), capture_width_ values per sample
+  std::vector<int32_t> capture_values_;
+  std::vector<uint32_t> capture_times_;
+  uint16_t capture_count_{0};
+  bool capturing_{false};
+  // Keeps loop() running back to back while capturing
+  HighFrequencyLoopRequester high_freq_;
+  uint32_t capture_start_{0};
+  // Next sample to log, the rows are spread over several loop() calls
+  uint16_t capture_logged_{0};
+  // IRQ1 still low after servicing, STATUS1 got a new flag without a new edge
+  bool irq1_retrigger_{false};
+  uint8_t irq1_dropped_{0};
 
-  i2c::ErrorCode ade_write_(uint16_t reg, uint32_t val);
+  ADE7880Op ops_[ADE7880_MAX_OPS];
+  uint8_t op_count_{0};
+  bool op_overflow_{false};
+
+  // Last register access, used for batch verification
+  uint8_t last_op_{0};
+  uint8_t last_size_{0};
+  uint16_t last_reg_{0};
+  uint32_t last_data_{0};
+
+  i2c::ErrorCode ade_write_(uint16_t reg, uint32_t val, bool stop = true);
   i2c::ErrorCode ade_verify_last_(uint8_t op, uint16_t reg);
   i2c::ErrorCode ade_verify_write_(uint16_t reg) { return ade_verify_last_(0xCA, reg); }
   i2c::ErrorCode ade_write_verify_(uint16_t reg, uint32_t val);
   i2c::ErrorCode ade_read_(uint16_t reg, uint32_t *val);
   i2c::ErrorCode ade_read_verify_(uint16_t reg, uint32_t *val);
-  bool ade_read_check_(uint16_t reg, uint32_t expected_value, uint32_t mask = 0x0);
-
-  uint8_t ade_reg_size_(uint16_t reg) const;
+  i2c::ErrorCode ade_read_burst_(uint16_t reg, uint32_t *vals, uint8_t count);
+  i2c::ErrorCode ade_read_burst_verify_(uint16_t reg, uint32_t *vals, uint8_t count);
+  // Runtime accesses are queued and committed together, verified according to verify_mode_.
+  // Consecutive writes share one transaction through repeated starts, a read ends its own since
+  // the I2C bus API always stops after the data phase.
+  bool ade_queue_write_(uint16_t reg, uint32_t val);
+  bool ade_queue_read_(uint16_t reg, uint32_t *vals, uint8_t count);
+  i2c::ErrorCode ade_commit_();
+  i2c::ErrorCode ade_commit_(bool verify);
+  i2c::ErrorCode ade_read_batch_(uint16_t reg, uint32_t *vals, uint8_t count);
+  i2c::ErrorCode ade_verify_batch_();
+  i2c::ErrorCode ade_write_protect_(bool enable);
 
   void ade_setup_();
   bool ade_init_();
+  // Writes the entries of INIT_REGISTERS and reads them back, init_value_() skips unused ones
+  i2c::ErrorCode ade_write_init_();
+  i2c::ErrorCode ade_verify_init_();
+  bool init_value_(uint8_t index, uint32_t *value) const;
+  void ade_warm_setup_();
+  void record_checksum_();
+  void check_integrity_(bool confirm);
+  void repair_configuration_();
 
-  void publish_sensor(sensor::Sensor *sensor, uint16_t reg, float factor = 1.0f);
+  bool service_irq0_();
+  void service_irq1_();
+  void setup_events_();
+  void rearm_events_();
+  void publish_direction_(uint32_t phsign);
+  void select_angles_(uint16_t anglesel);
+  uint32_t mask0_active_() const;
+  void setup_capture_();
+  void store_capture_(const uint32_t *samples, uint32_t time);
+  void log_capture_();
+  void record_peaks_(uint32_t ipeak, uint32_t vpeak);
+  void publish_peaks_();
+  uint8_t queue_statistics_(uint32_t *rms, uint32_t *watt);
+  void record_statistics_(uint8_t count, const uint32_t *rms, const uint32_t *watt);
+  void sample_statistics_();
+  void publish_statistics_();
+  void publish_event_(const char *event, uint8_t phase, uint32_t time, const char *detail = nullptr);
+  bool service_energy_();
+  bool read_energy_();
+
+  void setup_blocks_();
+  void update_no_load_();
+  uint8_t sensor_group_(sensor::Sensor *sensor);
+  uint8_t take_due_groups_(bool due);
+  void start_pass_(uint8_t groups);
+  void publish_slice_();
+  void record_slice_(uint32_t start);
+  void read_block_(ADE7880Block *block);
+  void publish_block_(const ADE7880Block *block);
 
   void reset_watchdog_();
+
+  void setup_harmonics_();
+  void start_harmonics_();
+  void service_harmonics_();
+  uint8_t harmonic_group_indexes_(uint8_t group, uint8_t *indexes) const;
+  bool harmonic_step_used_(uint8_t step) const;
+  void queue_harmonic_step_();
+  void publish_spectrum_();
+
+  uint64_t energy_total_(bool reactive) const;
+  void restore_energy_state_();
+  void flush_energy_(bool force);
 };
 
 } // namespace ade7880
@@ -5,16 +5,24 @@
 namespace esphome {
 namespace ade7880 {
 
-i2c::ErrorCode ADE7880::ade_write_(uint16_t reg, uint32_t value) {
-  uint8_t size = this->ade_reg_size_(reg);
+i2c::ErrorCode ADE7880::ade_write_(uint16_t reg, uint32_t value, bool stop) {
+  // Signed registers narrower than the communication width are masked by the caller, see
+  // INIT_MASKS, this only drops what doesn't fit on the wire
+  uint8_t size = ade_reg_size(reg);
   if(!size || size > 4) return i2c::ERROR_TOO_LARGE;
-  std::vector<uint8_t> data;
-  data.push_back((reg >> 8) & 0xFF);
-  data.push_back((reg >> 0) & 0xFF);
+  value &= ade_reg_mask(size * 8);
+  uint8_t data[6];
+  uint8_t len = 0;
+  data[len++] = (reg >> 8) & 0xFF;
+  data[len++] = (reg >> 0) & 0xFF;
+  this->last_size_ = size;
   while(size--) {
-    data.push_back((value >> (8*size)) & 0xFF);
+    data[len++] = (value >> (8*size)) & 0xFF;
   }
-  return this->write(data.data(), data.size());
+  this->last_op_ = 0xCA;
+  this->last_reg_ = reg;
+  this->last_data_ = value;
+  return this->write(data, len, stop);
 }
 
 i2c::ErrorCode ADE7880::ade_verify_last_(uint8_t op, uint16_t reg) {
@@ -40,70 +48,169 @@ i2c::ErrorCode ADE7880::ade_write_verify_(uint16_t reg, uint32_t value) {
 }
 
 i2c::ErrorCode ADE7880::ade_read_(uint16_t reg, uint32_t *value) {
-  uint8_t size = this->ade_reg_size_(reg);
+  return this->ade_read_burst_(reg, value, 1);
+}
+
+i2c::ErrorCode ADE7880::ade_read_burst_(uint16_t reg, uint32_t *values, uint8_t count) {
+  uint8_t size = ade_reg_size(reg);
   if(!size || size > 4) {
     ESP_LOGE("ade7880", "Invalid reg size [reg=0x%04X, size=%d]", reg, size);
     return i2c::ERROR_TOO_LARGE;
   }
+  if(!count || count > ADE7880_MAX_BURST_READ) {
+    ESP_LOGE("ade7880", "Invalid burst [reg=0x%04X, count=%d]", reg, count);
+    return i2c::ERROR_INVALID_ARGUMENT;
+  }
+  // All registers of a burst must share the same width
+  for(uint8_t n=1; n<count; n++) {
+    if(ade_reg_size(reg + n) != size) {
+      ESP_LOGE("ade7880", "Invalid burst width [reg=0x%04X, count=%d]", reg + n, count);
+      return i2c::ERROR_INVALID_ARGUMENT;
+    }
+  }
   uint8_t reg_data[2];
   reg_data[0] = (reg >> 8) & 0xFF;
   reg_data[1] = (reg >> 0) & 0xFF;
-  i2c::ErrorCode err = this->write(reg_data, 2);
+  // Repeated start between the address and the data phase
+  i2c::ErrorCode err = this->write(reg_data, 2, false);
   if (err != i2c::ERROR_OK)
     return err;
-  uint8_t recv[4];
-  err = this->read(recv, size);
+  uint8_t recv[4 * ADE7880_MAX_BURST_READ];
+  err = this->read(recv, size * count);
   if (err != i2c::ERROR_OK)
     return err;
-  *value = 0;
-  for(uint32_t i=0; i<size; i++) {
-    *value = (*value << 8) | ((uint32_t)recv[i]);
+  const uint8_t *data = recv;
+  for(uint8_t n=0; n<count; n++) {
+    values[n] = 0;
+    for(uint32_t i=0; i<size; i++) {
+      values[n] = (values[n] << 8) | ((uint32_t)*data++);
+    }
   }
+  this->last_op_ = 0x35;
+  this->last_reg_ = reg + count - 1;
+  this->last_data_ = values[count - 1];
+  this->last_size_ = size;
   return i2c::ERROR_OK;
 }
 
 i2c::ErrorCode ADE7880::ade_read_verify_(uint16_t reg, uint32_t *value) {
-  uint32_t ret;
-  i2c::ErrorCode err = this->ade_read_(reg, value);
+  return this->ade_read_burst_verify_(reg, value, 1);
+}
+
+i2c::ErrorCode ADE7880::ade_read_burst_verify_(uint16_t reg, uint32_t *values, uint8_t count) {
+  i2c::ErrorCode err = this->ade_read_burst_(reg, values, count);
   if (err != i2c::ERROR_OK)
     return err;
-  return this->ade_verify_last_(0x35, reg);
+  // Last accessed address is the final register of the burst
+  return this->ade_verify_last_(0x35, reg + count - 1);
 }
 
-bool ADE7880::ade_read_check_(uint16_t reg, uint32_t expected_value, uint32_t mask) {
-  uint32_t ret;
-  i2c::ErrorCode err = this->ade_read_verify_(reg, &ret);
-  if(err != i2c::ERROR_OK) {
+bool ADE7880::ade_queue_write_(uint16_t reg, uint32_t value) {
+  if(this->op_count_ >= ADE7880_MAX_OPS) {
+    this->op_overflow_ = true;
     return false;
   }
-  if(mask) {
-    return (expected_value & mask) == (ret & mask);
+  ADE7880Op &op = this->ops_[this->op_count_++];
+  op.reg = reg;
+  op.count = 0;
+  op.value = value;
+  op.values = nullptr;
+  return true;
+}
+
+bool ADE7880::ade_queue_read_(uint16_t reg, uint32_t *values, uint8_t count) {
+  if(this->op_count_ >= ADE7880_MAX_OPS || !count) {
+    this->op_overflow_ = true;
+    return false;
   }
-  return expected_value == ret;
+  ADE7880Op &op = this->ops_[this->op_count_++];
+  op.reg = reg;
+  op.count = count;
+  op.value = 0;
+  op.values = values;
+  return true;
 }
 
-uint8_t ADE7880::ade_reg_size_(uint16_t reg) const {
-  uint8_t size = 0;
-  switch ((reg >> 8) & 0x0F) {
-    case 0x03:  // 32-bit
-    case 0x04:
-    case 0x05:
-    case 0x08:
-      size++;
-      size++;
-    case 0x01:  // 16-bit
-    case 0x02:
-    case 0x06:
-    case 0x09:
-      size++;
-    case 0x00:  // 8-bit
-    case 0x07:
-    case 0x0A:
-    case 0x0B:
-    case 0x0C:
-      size++;
+i2c::ErrorCode ADE7880::ade_commit_() { return this->ade_commit_(this->verify_mode_ == VERIFY_PER_REGISTER); }
+
+i2c::ErrorCode ADE7880::ade_commit_(bool verify) {
+  uint8_t op_count = this->op_count_;
+  bool overflow = this->op_overflow_;
+  this->op_count_ = 0;
+  this->op_overflow_ = false;
+  if(overflow) {
+    ESP_LOGE("ade7880", "Transaction queue overflow");
+    return i2c::ERROR_TOO_LARGE;
+  }
+
+  i2c::ErrorCode err = i2c::ERROR_OK;
+  for(uint8_t n=0; n<op_count && err == i2c::ERROR_OK; n++) {
+    const ADE7880Op &op = this->ops_[n];
+    if(op.count) {
+      // Ends with a stop, the bus has no read without one
+      err = this->ade_read_burst_(op.reg, op.values, op.count);
+      if(err == i2c::ERROR_OK && verify)
+        err = this->ade_verify_last_(0x35, op.reg + op.count - 1);
+    }
+    else {
+      // Chain with a repeated start unless a verification read follows
+      bool stop = verify || n + 1 == op_count;
+      err = this->ade_write_(op.reg, op.value, stop);
+      if(err == i2c::ERROR_OK && verify)
+        err = this->ade_verify_write_(op.reg);
+    }
+  }
+  return err;
+}
+
+i2c::ErrorCode ADE7880::ade_read_batch_(uint16_t reg, uint32_t *values, uint8_t count) {
+  this->ade_queue_read_(reg, values, count);
+  return this->ade_commit_();
+}
+
+i2c::ErrorCode ADE7880::ade_verify_batch_() {
+  if(this->verify_mode_ != VERIFY_PER_BATCH)
+    return i2c::ERROR_OK;
+
+  // Reading the LAST_* registers doesn't change them, so capture the expected
+  // access before the verification reads overwrite the tracked values
+  uint8_t op = this->last_op_;
+  uint16_t reg = this->last_reg_;
+  uint32_t data = this->last_data_;
+  uint8_t size = this->last_size_;
+  if(!size)
+    return i2c::ERROR_OK;
+
+  uint16_t rwdata_reg = ADE7880_LAST_RWDATA8;
+  uint32_t mask = 0xFF;
+  if(size == 2) {
+    rwdata_reg = ADE7880_LAST_RWDATA16;
+    mask = 0xFFFF;
+  }
+  else if(size == 4) {
+    rwdata_reg = ADE7880_LAST_RWDATA32;
+    mask = 0xFFFFFFFF;
+  }
+
+  uint32_t last_op, last_add, last_data;
+  this->ade_queue_read_(ADE7880_LAST_OP, &last_op, 1);
+  this->ade_queue_read_(ADE7880_LAST_ADD, &last_add, 1);
+  this->ade_queue_read_(rwdata_reg, &last_data, 1);
+  i2c::ErrorCode err = this->ade_commit_();
+  if(err != i2c::ERROR_OK)
+    return err;
+  if(last_op != op || last_add != reg || (last_data & mask) != (data & mask))
+    return i2c::ERROR_UNKNOWN;
+  return i2c::ERROR_OK;
+}
+
+i2c::ErrorCode ADE7880::ade_write_protect_(bool enable) {
+  // See page 40
+  i2c::ErrorCode err = this->ade_write_(ADE7880_DSPWP_SEL, 0xad);
+  if(err != i2c::ERROR_OK) {
+    return err;
   }
-  return size;
+  return this->ade_write_(ADE7880_DSPWP_SET, enable ? 0x80 : 0x00);
 }
 
 } // namespace ade7880
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+
 namespace esphome {
 namespace ade7880 {
 
@@ -251,7 +253,9 @@ enum Status1Register {
   STATUS1_MISMTCH = 1 << 20,       // Bit 20 When this bit is set to 1, it indicates ISUMLVLINWVISUM >− , where ISUMLVL is indicated in the ISUMLVL register.
   STATUS1_RESERVED1 = 1 << 21,     // Bit 21 Reserved. This bit is always set to 1.
   STATUS1_RESERVED2 = 1 << 22,     // Bit 22 Reserved. This bit is always set to 0.
-  STATUS1_PKI = 1 << 23            // Bit 23 When this bit is set to 1, it indicates that the period used to detect the peak value in the current channel has ended. The IPEAK register contains the peak value and the phase where the peak has been detected (see Table 34).
+  STATUS1_PKI = 1 << 23,           // Bit 23 When this bit is set to 1, it indicates that the period used to detect the peak value in the current channel has ended. The IPEAK register contains the peak value and the phase where the peak has been detected (see Table 34).
+  STATUS1_PKV = 1 << 24,           // Bit 24 When this bit is set to 1, it indicates that the period used to detect the peak value in the voltage channel has ended. The VPEAK register contains the peak value and the phase where the peak has been detected (see Table 35).
+  STATUS1_CRC = 1 << 25            // Bit 25 When this bit is set to 1, it indicates that the latest checksum value is different from the checksum value computed when Run register was set to 1.
 };
 
 // Page 96-97 Table 38. MASK0 Register (Address 0xE50A)
@@ -308,6 +312,40 @@ enum Mask1Register {
   MASK1_CRC = 1 << 25              // Bit 25 When this bit is set to 1, it enables an interrupt when the latest checksum value is different from the checksum value computed when Run register was set to 1.
 };
 
+// Page 95 Table 34/35. IPEAK and VPEAK Registers (Address 0xE500, 0xE501)
+enum PeakRegister {
+  PEAK_VALUE = 0xFFFFFF,           // Bits 23:0  Peak value of the selected phases over PEAKCYC half line cycles.
+  PEAK_PHASE_A = 1 << 24,          // Bit 24 When this bit is set to 1, Phase A generated the peak value.
+  PEAK_PHASE_B = 1 << 25,          // Bit 25 When this bit is set to 1, Phase B generated the peak value.
+  PEAK_PHASE_C = 1 << 26           // Bit 26 When this bit is set to 1, Phase C generated the peak value.
+};
+
+// Page 98 Table 40. PHSTATUS Register (Address 0xE600)
+enum PhstatusRegister {
+  PHSTATUS_OIPHASE_A = 1 << 3,     // Bit 3  When this bit is set to 1, Phase A current generated Bit OI in the STATUS1 register.
+  PHSTATUS_OIPHASE_B = 1 << 4,     // Bit 4  When this bit is set to 1, Phase B current generated Bit OI in the STATUS1 register.
+  PHSTATUS_OIPHASE_C = 1 << 5,     // Bit 5  When this bit is set to 1, Phase C current generated Bit OI in the STATUS1 register.
+  PHSTATUS_OVPHASE_A = 1 << 9,     // Bit 9  When this bit is set to 1, Phase A voltage generated Bit OV in the STATUS1 register.
+  PHSTATUS_OVPHASE_B = 1 << 10,    // Bit 10 When this bit is set to 1, Phase B voltage generated Bit OV in the STATUS1 register.
+  PHSTATUS_OVPHASE_C = 1 << 11,    // Bit 11 When this bit is set to 1, Phase C voltage generated Bit OV in the STATUS1 register.
+  PHSTATUS_VSPHASE_A = 1 << 12,    // Bit 12 When this bit is set to 1, Phase A voltage generated Bit SAG in the STATUS1 register.
+  PHSTATUS_VSPHASE_B = 1 << 13,    // Bit 13 When this bit is set to 1, Phase B voltage generated Bit SAG in the STATUS1 register.
+  PHSTATUS_VSPHASE_C = 1 << 14     // Bit 14 When this bit is set to 1, Phase C voltage generated Bit SAG in the STATUS1 register.
+};
+
+// Page 98-99 Table 41. PHNOLOAD Register (Address 0xE608)
+enum PhnoloadRegister {
+  PHNOLOAD_NLPHASE_A = 1 << 0,     // Bit 0  0: Phase A is out of no load condition based on total active/reactive powers. 1: Phase A is in no load condition based on total active/reactive powers.
+  PHNOLOAD_NLPHASE_B = 1 << 1,     // Bit 1  0: Phase B is out of no load condition based on total active/reactive powers. 1: Phase B is in no load condition based on total active/reactive powers.
+  PHNOLOAD_NLPHASE_C = 1 << 2,     // Bit 2  0: Phase C is out of no load condition based on total active/reactive powers. 1: Phase C is in no load condition based on total active/reactive powers.
+  PHNOLOAD_FNLPHASE_A = 1 << 3,    // Bit 3  0: Phase A is out of no load condition based on fundamental active/reactive powers. 1: Phase A is in no load condition based on fundamental active/reactive powers.
+  PHNOLOAD_FNLPHASE_B = 1 << 4,    // Bit 4  0: Phase B is out of no load condition based on fundamental active/reactive powers. 1: Phase B is in no load condition based on fundamental active/reactive powers.
+  PHNOLOAD_FNLPHASE_C = 1 << 5,    // Bit 5  0: Phase C is out of no load condition based on fundamental active/reactive powers. 1: Phase C is in no load condition based on fundamental active/reactive powers.
+  PHNOLOAD_VANLPHASE_A = 1 << 6,   // Bit 6  0: Phase A is out of no load condition based on apparent power. 1: Phase A is in no load condition based on apparent power.
+  PHNOLOAD_VANLPHASE_B = 1 << 7,   // Bit 7  0: Phase B is out of no load condition based on apparent power. 1: Phase B is in no load condition based on apparent power.
+  PHNOLOAD_VANLPHASE_C = 1 << 8    // Bit 8  0: Phase C is out of no load condition based on apparent power. 1: Phase C is in no load condition based on apparent power.
+};
+
 // Page 99 Table 42. COMPMODE Register (Address 0xE60E)
 enum CompmodeRegister {
   COMPMODE_TERMSEL1_0 = 1 << 0,            // Bit 0  Setting all TERMSEL1[2:0] to 1 signifies the sum of all three phases is included in the CF1 output. Phase A is included in the CF1 outputs calculations.
@@ -333,6 +371,27 @@ enum CompmodeRegister {
   COMPMODE_PFMODE = 1 << 15,               // Bit 15 When this bit is 0, power factor calculation uses instantaneous values of various phase powers used in its expression. When this bit is 1, power factor calculation uses phase energies values calculated using line cycle accumulation mode. Bits LWATT and LVA in LCYCMODE register must be enabled for the power factors to be computed correctly. The update rate of the power factor measurement in t
 };
 
+// Page 101 Table 46. PHSIGN Register (Address 0xE617)
+enum PhsignRegister {
+  PHSIGN_AWSIGN = 1 << 0,          // Bit 0  0: if the active power on Phase A identified by Bit 6 (REVAPSEL) in the ACCMODE register (total or fundamental) is positive. 1: if the active power is negative.
+  PHSIGN_BWSIGN = 1 << 1,          // Bit 1  0: if the active power on Phase B identified by Bit 6 (REVAPSEL) in the ACCMODE register (total or fundamental) is positive. 1: if the active power is negative.
+  PHSIGN_CWSIGN = 1 << 2,          // Bit 2  0: if the active power on Phase C identified by Bit 6 (REVAPSEL) in the ACCMODE register (total or fundamental) is positive. 1: if the active power is negative.
+  PHSIGN_SUM1SIGN = 1 << 3,        // Bit 3  0: if the sum of all phase powers in the CF1 data path is positive. 1: if the sum of all phase powers in the CF1 data path is negative.
+  PHSIGN_AFVARSIGN = 1 << 4,       // Bit 4  0: if the fundamental reactive power on Phase A is positive. 1: if the fundamental reactive power on Phase A is negative.
+  PHSIGN_BFVARSIGN = 1 << 5,       // Bit 5  0: if the fundamental reactive power on Phase B is positive. 1: if the fundamental reactive power on Phase B is negative.
+  PHSIGN_CFVARSIGN = 1 << 6,       // Bit 6  0: if the fundamental reactive power on Phase C is positive. 1: if the fundamental reactive power on Phase C is negative.
+  PHSIGN_SUM2SIGN = 1 << 7,        // Bit 7  0: if the sum of all phase powers in the CF2 data path is positive. 1: if the sum of all phase powers in the CF2 data path is negative.
+  PHSIGN_SUM3SIGN = 1 << 8         // Bit 8  0: if the sum of all phase powers in the CF3 data path is positive. 1: if the sum of all phase powers in the CF3 data path is negative.
+};
+
+// Page 103 Table 48. MMODE Register (Address 0xE700)
+enum MmodeRegister {
+  MMODE_PERSEL_A = 0 << 0,         // Bits 1:0 00: Phase A is the source of the period measurement. 01: Phase B. 10: Phase C.
+  MMODE_PEAKSEL_A = 1 << 2,        // Bit 2  When this bit is set to 1, Phase A is selected for the voltage and current peak registers.
+  MMODE_PEAKSEL_B = 1 << 3,        // Bit 3  When this bit is set to 1, Phase B is selected for the voltage and current peak registers.
+  MMODE_PEAKSEL_C = 1 << 4         // Bit 4  When this bit is set to 1, Phase C is selected for the voltage and current peak registers. If more than one phase is selected, the peak registers hold the largest value of the selected phases.
+};
+
 // Page 104-105 Table 51. LCYCMODE Register (Address 0xE702)
 enum LcycmodeRegister {
   LCYCMODE_LWATT = 1 << 0,         // Bit 0  0: the watt-hour accumulation registers (AWATTHR, BWATTHR, CWATTHR, AFWATTHR, BFWATTHR, and CFWATTHR) are placed in regular accumulation mode.
@@ -353,6 +412,28 @@ enum LcycmodeRegister {
                                    //        1: power factor calculation uses phase energies values calculated using line cycle accumulation mode. Bits LWATT and LVA in LCYCMODE register must be enabled for the power factors to be computed correctly. The update rate of the power factor measurement in t
 };
 
+// Page 105 Table 54. HCONFIG Register (Address 0xE900)
+enum HconfigRegister {
+  HCONFIG_HRCFG = 1 << 0,          // Bit 0  0: HREADY is set after HSTIME following the harmonic block setup, then at HRATE.
+                                   //        1: HREADY is set immediately after the harmonic block setup, then at HRATE.
+  HCONFIG_HPHASE_A = 0 << 1,       // Bits 1-2 00: Phase A voltage and current are analyzed.
+  HCONFIG_HPHASE_B = 1 << 1,       // Bits 1-2 01: Phase B voltage and current are analyzed.
+  HCONFIG_HPHASE_C = 2 << 1,       // Bits 1-2 10: Phase C voltage and current are analyzed.
+  HCONFIG_HPHASE = 3 << 1,
+  HCONFIG_HSTIME_500MS = 0 << 3,   // Bits 3-4 Delay between the harmonic block setup and the first HREADY.
+  HCONFIG_HSTIME_750MS = 1 << 3,
+  HCONFIG_HSTIME_1000MS = 2 << 3,
+  HCONFIG_HSTIME_1250MS = 3 << 3,
+  HCONFIG_HRATE_125US = 0 << 5,    // Bits 5-7 Update rate of the harmonic block output registers.
+  HCONFIG_HRATE_250US = 1 << 5,
+  HCONFIG_HRATE_1MS = 2 << 5,
+  HCONFIG_HRATE_16MS = 3 << 5,
+  HCONFIG_HRATE_128MS = 4 << 5,
+  HCONFIG_HRATE_512MS = 5 << 5,
+  HCONFIG_HRATE_1024MS = 6 << 5,
+  HCONFIG_HRATE_DISABLED = 7 << 5
+};
+
 // Page 106 Table 56. CONFIG2 Register (Address 0xEC01)
 enum Config2Register {
   CONFIG2_EXTREFEN = 1 << 0,       // Bit 0  When this bit is 0, it signifies that the internal voltage reference is used in the ADCs.
@@ -360,5 +441,89 @@ enum Config2Register {
   CONFIG2_I2C_LOCK = 1 << 1,       // Bit 1  When this bit is 0, the SS/HSA pin can be toggled three times to activate the SPI port. If I2 C is the active serial port, this bit must be set to 1 to lock it in. From this moment on, toggling of the SS/HSA pin and an eventual switch into using the SPI port is no longer possible. If SPI is the active serial port, any write to CONFIG2 register locks the port. From this moment on, a switch into using I2 C port is no longer possible. Once locked, the serial port choice is maintained when the ADE7880 changes PSMx power modes.
 };
 
+// Run Register (Address 0xE228), see the Digital Signal Processor section on page 40
+enum RunRegister {
+  RUN_STOP = 0x0000,               // Writing 0x0000 stops the DSP.
+  RUN_START = 0x0001,              // Bit 0  Writing 0x0001 starts the DSP, the bit reads back as 1 while it runs.
+};
+
+// Wire encoding of the register values (pages 87-93, CommBln column)
+enum RegisterEncoding : uint8_t {
+  ENC_PLAIN,                       // Transmitted with the register's own width
+  ENC_ZP,                          // Zero-padded to the communication width
+  ENC_ZPSE,                        // Sign extended to 28 bits and zero-padded to 32 bits
+  ENC_SE,                          // Sign extended to 32 bits
+};
+
+struct RegisterRange {
+  uint16_t first;
+  uint16_t last;
+  uint8_t bits;                    // Significant bits
+  RegisterEncoding encoding;
+  bool is_signed;
+};
+
+// Registers which differ from an unsigned value of the communication width
+static constexpr RegisterRange REGISTER_RANGES[] = {
+  {ADE7880_AIGAIN, ADE7880_NIRMSOS, 24, ENC_ZPSE, true},
+  {ADE7880_HPGAIN, ADE7880_ISUMLVL, 24, ENC_ZPSE, true},
+  {ADE7880_VLEVEL, ADE7880_VLEVEL, 28, ENC_ZP, true},
+  {ADE7880_AFWATTOS, ADE7880_HZVRMSOS, 24, ENC_ZPSE, true},
+  {ADE7880_AIRMS, ADE7880_NIRMS, 24, ENC_ZP, true},
+  {ADE7880_ISUM, ADE7880_ISUM, 28, ENC_ZP, true},
+  {ADE7880_AWATTHR, ADE7880_CVAHR, 32, ENC_PLAIN, true},
+  {ADE7880_AIMAV, ADE7880_CIMAV, 20, ENC_ZP, false},
+  {ADE7880_OILVL, ADE7880_SAGLVL, 24, ENC_ZP, false},
+  {ADE7880_IAWV, ADE7880_CVA, 24, ENC_SE, true},
+  {ADE7880_VNOM, ADE7880_VNOM, 24, ENC_ZP, true},
+  {ADE7880_APHCAL, ADE7880_CPHCAL, 10, ENC_ZP, true},
+  {ADE7880_FVRMS, ADE7880_HZIHD, 24, ENC_SE, true},
+  {ADE7880_APF, ADE7880_CPF, 16, ENC_PLAIN, true},
+};
+
+// Register width is selected by bits 11:8 of the address
+static constexpr uint8_t REGISTER_PAGE_SIZE[16] = {1, 2, 2, 4, 4, 4, 2, 1, 4, 2, 1, 1, 1, 0, 0, 0};
+
+struct RegisterCodec {
+  uint8_t size;                    // Bytes on the wire
+  uint8_t shift;                   // Sign extension shift, 0 when no extension is needed
+  uint32_t mask;                   // Bits written to the register
+};
+
+constexpr uint8_t ade_reg_size(uint16_t reg) { return REGISTER_PAGE_SIZE[(reg >> 8) & 0x0F]; }
+
+constexpr uint32_t ade_reg_mask(uint8_t bits) { return bits >= 32 ? 0xFFFFFFFF : (1UL << bits) - 1; }
+
+constexpr RegisterCodec ade_reg_codec(uint16_t reg) {
+  uint8_t size = ade_reg_size(reg);
+  for(const RegisterRange &range : REGISTER_RANGES) {
+    if(reg < range.first || reg > range.last) {
+      continue;
+    }
+    uint8_t shift = range.is_signed ? 32 - range.bits : 0;
+    switch(range.encoding) {
+      case ENC_ZP:
+        return {size, shift, ade_reg_mask(range.bits)};
+      case ENC_ZPSE:
+        return {size, shift, ade_reg_mask(28)};
+      default:
+        return {size, shift, ade_reg_mask(size * 8)};
+    }
+  }
+  return {size, 0, ade_reg_mask(size * 8)};
+}
+
+// Sign extend a raw register value, branch free
+inline int32_t ade_reg_decode(uint32_t raw, uint8_t shift) {
+  return (int32_t)(raw << shift) >> shift;
+}
+
+static_assert(ade_reg_codec(ADE7880_AIGAIN).mask == 0x0FFFFFFF, "ZPSE registers are written with 28 bits");
+static_assert(ade_reg_codec(ADE7880_AIRMS).shift == 8, "24-bit rms registers need sign extension");
+static_assert(ade_reg_codec(ADE7880_APF).size == 2 && ade_reg_codec(ADE7880_APF).shift == 16, "PF is 16-bit signed");
+static_assert(ade_reg_codec(ADE7880_APERIOD).shift == 0, "Period is unsigned");
+static_assert(ade_reg_codec(ADE7880_APHCAL).mask == 0x03FF, "Phase calibration is 10 bits");
+static_assert(ade_reg_codec(ADE7880_LCYCMODE).size == 1, "LCYCMODE is 8-bit");
+
 } // namespace ade7880
 } // namespace esphome
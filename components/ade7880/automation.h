@@ -0,0 +1,16 @@
+#pragma once
+
+#include "esphome/core/automation.h"
+#include "esphome/core/helpers.h"
+#include "ade7880.h"
+
+namespace esphome {
+namespace ade7880 {
+
+template<typename... Ts> class CaptureWaveformAction : public Action<Ts...>, public Parented<ADE7880> {
+ public:
+  void play(Ts... x) override { this->parent_->start_capture(); }
+};
+
+} // namespace ade7880
+} // namespace esphome
@@ -1,7 +1,8 @@
 import esphome.codegen as cg
 import esphome.config_validation as cv
-from esphome.components import sensor, i2c
-from esphome import pins
+from esphome.components import binary_sensor, sensor, text_sensor, i2c
+from esphome import automation, pins
+from esphome.automation import maybe_simple_id
 from esphome.const import (
     CONF_ACTIVE_POWER,
     CONF_APPARENT_POWER,
@@ -10,6 +11,8 @@ from esphome.const import (
     CONF_FORWARD_ACTIVE_ENERGY,
     CONF_FREQUENCY,
     CONF_ID,
+    CONF_INDEX,
+    CONF_INTERVAL,
     CONF_NAME,
     CONF_PHASE_A,
     CONF_PHASE_ANGLE,
@@ -19,6 +22,7 @@ from esphome.const import (
     CONF_REACTIVE_POWER,
     CONF_RESET_PIN,
     CONF_REVERSE_ACTIVE_ENERGY,
+    CONF_UPDATE_INTERVAL,
     CONF_VOLTAGE,
     CONF_VOLTAGE_GAIN,
     CONF_WATCHDOG_THRESHOLD,
@@ -27,25 +31,34 @@ from esphome.const import (
     DEVICE_CLASS_ENERGY,
     DEVICE_CLASS_POWER,
     DEVICE_CLASS_POWER_FACTOR,
+    DEVICE_CLASS_PROBLEM,
     DEVICE_CLASS_VOLTAGE,
+    ENTITY_CATEGORY_DIAGNOSTIC,
     STATE_CLASS_MEASUREMENT,
     STATE_CLASS_TOTAL_INCREASING,
     UNIT_AMPERE,
+    UNIT_DEGREES,
     UNIT_HERTZ,
+    UNIT_MILLISECOND,
     UNIT_PERCENT,
     UNIT_VOLT,
     UNIT_VOLT_AMPS,
     UNIT_VOLT_AMPS_REACTIVE,
+    UNIT_VOLT_AMPS_REACTIVE_HOURS,
     UNIT_WATT,
     UNIT_WATT_HOURS,
 )
 
 DEPENDENCIES = ["i2c"]
+AUTO_LOAD = ["binary_sensor", "text_sensor"]
 
 ade7880_ns = cg.esphome_ns.namespace("ade7880")
 ADE7880 = ade7880_ns.class_("ADE7880", cg.PollingComponent, i2c.I2CDevice)
 NeutralChannel = ade7880_ns.struct("NeutralChannel")
 PowerChannel = ade7880_ns.struct("PowerChannel")
+VerifyMode = ade7880_ns.enum("ADE7880VerifyMode")
+EnergyMode = ade7880_ns.enum("ADE7880EnergyMode")
+CaptureWaveformAction = ade7880_ns.class_("CaptureWaveformAction", automation.Action)
 
 CONF_CURRENT_GAIN = "current_gain"
 CONF_IRQ0_PIN = "irq0_pin"
@@ -53,9 +66,148 @@ CONF_IRQ1_PIN = "irq1_pin"
 CONF_POWER_GAIN = "power_gain"
 CONF_TOTAL_POWER_GAIN = "total_power_gain"
 CONF_FAILURE_THRESHOLD = "failure_threshold"
+CONF_VERIFY = "verify"
+CONF_ENERGY_MODE = "energy_mode"
+CONF_NOMINAL_VOLTAGE = "nominal_voltage"
+CONF_SLICE_BUDGET = "slice_budget"
+CONF_MAX_SLICE_DURATION = "max_slice_duration"
+CONF_RESTORE_ENERGY = "restore_energy"
+CONF_FLUSH_INTERVAL = "flush_interval"
+CONF_MIN_FLUSH_INTERVAL = "min_flush_interval"
+CONF_ENERGY_DELTA = "energy_delta"
+CONF_FLUSH_ON_SHUTDOWN = "flush_on_shutdown"
+CONF_VOLTAGE_THD = "voltage_thd"
+CONF_CURRENT_THD = "current_thd"
+CONF_HARMONICS = "harmonics"
+CONF_HARMONIC_SWEEP = "harmonic_sweep"
+CONF_INDEXES = "indexes"
+CONF_STEPS_PER_UPDATE = "steps_per_update"
+CONF_VOLTAGE_SPECTRUM = "voltage_spectrum"
+CONF_CURRENT_SPECTRUM = "current_spectrum"
+CONF_FORWARD_REACTIVE_ENERGY = "forward_reactive_energy"
+CONF_REVERSE_REACTIVE_ENERGY = "reverse_reactive_energy"
+CONF_FUNDAMENTAL_VOLTAGE = "fundamental_voltage"
+CONF_FUNDAMENTAL_CURRENT = "fundamental_current"
+CONF_FUNDAMENTAL_ACTIVE_POWER = "fundamental_active_power"
+CONF_FUNDAMENTAL_APPARENT_POWER = "fundamental_apparent_power"
+CONF_FUNDAMENTAL_POWER_FACTOR = "fundamental_power_factor"
+CONF_POWER_QUALITY = "power_quality"
+CONF_SAG_LEVEL = "sag_level"
+CONF_SAG_CYCLES = "sag_cycles"
+CONF_OVERVOLTAGE_LEVEL = "overvoltage_level"
+CONF_OVERCURRENT_LEVEL = "overcurrent_level"
+CONF_PEAK_CYCLES = "peak_cycles"
+CONF_EVENT = "event"
+CONF_SAG_EVENTS = "sag_events"
+CONF_PEAK_CURRENT = "peak_current"
+CONF_PEAK_VOLTAGE = "peak_voltage"
+CONF_OVERVOLTAGE_EVENTS = "overvoltage_events"
+CONF_OVERCURRENT_EVENTS = "overcurrent_events"
+CONF_CURRENT_ANGLE = "current_angle"
+CONF_VOLTAGE_ANGLE = "voltage_angle"
+CONF_PHASE_LOSS = "phase_loss"
+CONF_ZERO_CROSSING_TIMEOUT = "zero_crossing_timeout"
+CONF_PHASE_SEQUENCE_ERROR = "phase_sequence_error"
+CONF_REVERSE_POWER = "reverse_power"
+CONF_TOTAL_REVERSE_POWER = "total_reverse_power"
+CONF_NO_LOAD_LEVEL = "no_load_level"
+CONF_CURRENT_SUM_SAMPLE = "current_sum_sample"
+CONF_CURRENT_MISMATCH = "current_mismatch"
+CONF_MISMATCH_LEVEL = "mismatch_level"
+CONF_WAVEFORM_CAPTURE = "waveform_capture"
+CONF_SAMPLES = "samples"
+CONF_CHANNELS = "channels"
+CONF_LOG = "log"
+CONF_INTEGRITY_CHECK = "integrity_check"
+CONF_STATISTICS = "statistics"
+CONF_MIN = "min"
+CONF_MAX = "max"
+CONF_MEAN = "mean"
+CONF_STDDEV = "stddev"
+CONF_EVENTS = "events"
+
+# HX, HY and HZ track up to three harmonic indexes at a time
+MAX_HARMONIC_INDEXES = 3
+# Groups of sensors with their own update_interval besides the one of the component
+MAX_UPDATE_GROUPS = 7
+MULTI_RATE_SENSORS = (
+    CONF_VOLTAGE,
+    CONF_CURRENT,
+    CONF_ACTIVE_POWER,
+    CONF_APPARENT_POWER,
+    CONF_POWER_FACTOR,
+    CONF_FREQUENCY,
+)
+
+VERIFY_MODES = {
+    "per_register": VerifyMode.VERIFY_PER_REGISTER,
+    "per_batch": VerifyMode.VERIFY_PER_BATCH,
+    "none": VerifyMode.VERIFY_NONE,
+}
+
+ENERGY_MODES = {
+    "line_cycle": EnergyMode.ENERGY_LINE_CYCLE,
+    "running_total": EnergyMode.ENERGY_RUNNING_TOTAL,
+    "half_full": EnergyMode.ENERGY_HALF_FULL,
+}
 
 CONF_NEUTRAL = "neutral"
 
+# Bit positions follow the waveform registers IAWV..VCWV
+WAVEFORM_CHANNELS = {
+    "current_a": 0,
+    "current_b": 1,
+    "current_c": 2,
+    "current_n": 3,
+    "voltage_a": 4,
+    "voltage_b": 5,
+    "voltage_c": 6,
+}
+
+RESTORE_ENERGY_SCHEMA = cv.Schema(
+    {
+        cv.Optional(
+            CONF_FLUSH_INTERVAL, default="1h"
+        ): cv.positive_time_period_milliseconds,
+        cv.Optional(
+            CONF_MIN_FLUSH_INTERVAL, default="10min"
+        ): cv.positive_time_period_milliseconds,
+        # Wh accumulated before an early flush, 0 disables
+        cv.Optional(CONF_ENERGY_DELTA, default=0.0): cv.positive_float,
+        cv.Optional(CONF_FLUSH_ON_SHUTDOWN, default=True): cv.boolean,
+    }
+)
+
+# Samples are taken on DREADY as fast as the bus allows, far below the 8 kHz DSP rate over
+# I2C. Each sample is timestamped, the buffer is allocated at boot.
+WAVEFORM_CAPTURE_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_SAMPLES, default=256): cv.int_range(min=1, max=2048),
+        cv.Optional(CONF_CHANNELS, default=["voltage_a", "current_a"]): cv.All(
+            cv.ensure_list(cv.one_of(*WAVEFORM_CHANNELS, lower=True)), cv.Length(min=1)
+        ),
+        # Print the samples as CSV rows once the capture is complete
+        cv.Optional(CONF_LOG, default=True): cv.boolean,
+    }
+)
+
+# CHECKSUM is read once per interval, a changed configuration is written again without a reset
+INTEGRITY_CHECK_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_INTERVAL, default="10s"): cv.positive_time_period_milliseconds,
+        cv.Optional(CONF_EVENTS): sensor.sensor_schema(
+            accuracy_decimals=0,
+            state_class=STATE_CLASS_TOTAL_INCREASING,
+            entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+        ),
+    }
+)
+
+PROBLEM_SCHEMA = cv.maybe_simple_value(
+    binary_sensor.binary_sensor_schema(device_class=DEVICE_CLASS_PROBLEM),
+    key=CONF_NAME,
+)
+
 NEUTRAL_CHANNEL_SCHEMA = cv.Schema(
     {
         cv.GenerateID(): cv.declare_id(NeutralChannel),
@@ -69,6 +221,21 @@ NEUTRAL_CHANNEL_SCHEMA = cv.Schema(
             ),
             key=CONF_NAME,
         ),
+        # ISUM, one instantaneous sample of the phase current sum per update. Not an rms
+        # value, it swings with the line phase.
+        cv.Optional(CONF_CURRENT_SUM_SAMPLE): cv.maybe_simple_value(
+            sensor.sensor_schema(
+                unit_of_measurement=UNIT_AMPERE,
+                accuracy_decimals=2,
+                device_class=DEVICE_CLASS_CURRENT,
+                state_class=STATE_CLASS_MEASUREMENT,
+            ),
+            key=CONF_NAME,
+        ),
+        # On as soon as the phase current sum and the neutral current differ by more than the
+        # level (rms of a sine), off at the first update without a new mismatch
+        cv.Inclusive(CONF_CURRENT_MISMATCH, CONF_MISMATCH_LEVEL): PROBLEM_SCHEMA,
+        cv.Inclusive(CONF_MISMATCH_LEVEL, CONF_MISMATCH_LEVEL): cv.current,
         cv.Required(CONF_CALIBRATION): cv.Schema(
             {
                 cv.Required(CONF_CURRENT_GAIN): cv.int_,
@@ -77,6 +244,135 @@ NEUTRAL_CHANNEL_SCHEMA = cv.Schema(
     }
 )
 
+DISTORTION_SCHEMA = cv.maybe_simple_value(
+    sensor.sensor_schema(
+        unit_of_measurement=UNIT_PERCENT,
+        accuracy_decimals=2,
+        state_class=STATE_CLASS_MEASUREMENT,
+    ),
+    key=CONF_NAME,
+)
+
+
+def statistics_schema(unit, accuracy_decimals, device_class):
+    stat = cv.maybe_simple_value(
+        sensor.sensor_schema(
+            unit_of_measurement=unit,
+            accuracy_decimals=accuracy_decimals,
+            device_class=device_class,
+            state_class=STATE_CLASS_MEASUREMENT,
+        ),
+        key=CONF_NAME,
+    )
+    return cv.Schema(
+        {
+            cv.Optional(CONF_MIN): stat,
+            cv.Optional(CONF_MAX): stat,
+            cv.Optional(CONF_MEAN): stat,
+            cv.Optional(CONF_STDDEV): cv.maybe_simple_value(
+                sensor.sensor_schema(
+                    unit_of_measurement=unit,
+                    accuracy_decimals=accuracy_decimals,
+                    state_class=STATE_CLASS_MEASUREMENT,
+                ),
+                key=CONF_NAME,
+            ),
+        }
+    )
+
+
+# Sampled with each LENERGY service in line cycle and running total modes and by a one
+# second timer in half full mode, published on update
+STATISTICS_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_VOLTAGE): statistics_schema(UNIT_VOLT, 1, DEVICE_CLASS_VOLTAGE),
+        cv.Optional(CONF_CURRENT): statistics_schema(UNIT_AMPERE, 2, DEVICE_CLASS_CURRENT),
+        cv.Optional(CONF_ACTIVE_POWER): statistics_schema(UNIT_WATT, 1, DEVICE_CLASS_POWER),
+    }
+)
+
+ANGLE_SCHEMA = cv.maybe_simple_value(
+    sensor.sensor_schema(
+        unit_of_measurement=UNIT_DEGREES,
+        accuracy_decimals=1,
+        state_class=STATE_CLASS_MEASUREMENT,
+    ),
+    key=CONF_NAME,
+)
+
+# On while active power flows from the load back to the grid, updated on the sign change interrupt
+DIRECTION_SCHEMA = cv.maybe_simple_value(
+    binary_sensor.binary_sensor_schema(),
+    key=CONF_NAME,
+)
+
+EVENT_COUNTER_SCHEMA = cv.maybe_simple_value(
+    sensor.sensor_schema(
+        accuracy_decimals=0,
+        state_class=STATE_CLASS_TOTAL_INCREASING,
+    ),
+    key=CONF_NAME,
+)
+
+# Levels are rms values of a sine, the chip compares them to the waveform peaks
+POWER_QUALITY_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_SAG_LEVEL): cv.voltage,
+        cv.Optional(CONF_SAG_CYCLES, default=2): cv.int_range(min=1, max=255),
+        cv.Optional(CONF_OVERVOLTAGE_LEVEL): cv.voltage,
+        cv.Optional(CONF_OVERCURRENT_LEVEL): cv.current,
+        # Half line cycles per peak detection period, enables the peak events. Without
+        # it the peak sensors use one second periods.
+        cv.Optional(CONF_PEAK_CYCLES): cv.int_range(min=1, max=255),
+        # Time without voltage zero crossings before a phase_loss sensor turns on
+        cv.Optional(CONF_ZERO_CROSSING_TIMEOUT): cv.All(
+            cv.positive_time_period_milliseconds,
+            cv.Range(max=cv.TimePeriod(milliseconds=4095)),
+        ),
+        cv.Optional(CONF_PHASE_SEQUENCE_ERROR): PROBLEM_SCHEMA,
+        cv.Optional(CONF_EVENT): cv.maybe_simple_value(
+            text_sensor.text_sensor_schema(),
+            key=CONF_NAME,
+        ),
+    }
+)
+
+HARMONIC_SCHEMA = cv.Schema(
+    {
+        cv.Required(CONF_INDEX): cv.int_range(min=2, max=63),
+        cv.Optional(CONF_VOLTAGE): DISTORTION_SCHEMA,
+        cv.Optional(CONF_CURRENT): DISTORTION_SCHEMA,
+    }
+)
+
+def harmonic_index_list(value):
+    """Validate a list of harmonic indexes, a "first..last" string expands to a range."""
+    if isinstance(value, str) and ".." in value:
+        first, last = (cv.int_range(min=2, max=63)(v.strip()) for v in value.split("..", 1))
+        if first > last:
+            raise cv.Invalid("First harmonic index must not be greater than the last")
+        value = list(range(first, last + 1))
+    value = cv.ensure_list(cv.int_range(min=2, max=63))(value)
+    if len(set(value)) != len(value):
+        raise cv.Invalid("Harmonic indexes must be unique")
+    return value
+
+
+HARMONIC_SWEEP_SCHEMA = cv.Schema(
+    {
+        cv.Required(CONF_INDEXES): harmonic_index_list,
+        # Each step analyses up to three indexes on one phase and takes HSTIME (750 ms)
+        cv.Optional(CONF_STEPS_PER_UPDATE, default=3): cv.int_range(min=1, max=255),
+    }
+)
+
+# Block sensors with their own update_interval, all groups due at once share the burst reads
+MULTI_RATE_SCHEMA = cv.Schema(
+    {
+        cv.Optional(CONF_UPDATE_INTERVAL): cv.positive_time_period_milliseconds,
+    }
+)
+
 POWER_CHANNEL_SCHEMA = cv.Schema(
     {
         cv.GenerateID(): cv.declare_id(PowerChannel),
@@ -87,7 +383,7 @@ POWER_CHANNEL_SCHEMA = cv.Schema(
                 accuracy_decimals=1,
                 device_class=DEVICE_CLASS_VOLTAGE,
                 state_class=STATE_CLASS_MEASUREMENT,
-            ),
+            ).extend(MULTI_RATE_SCHEMA),
             key=CONF_NAME,
         ),
         cv.Optional(CONF_CURRENT): cv.maybe_simple_value(
@@ -96,7 +392,7 @@ POWER_CHANNEL_SCHEMA = cv.Schema(
                 accuracy_decimals=2,
                 device_class=DEVICE_CLASS_CURRENT,
                 state_class=STATE_CLASS_MEASUREMENT,
-            ),
+            ).extend(MULTI_RATE_SCHEMA),
             key=CONF_NAME,
         ),
         cv.Optional(CONF_ACTIVE_POWER): cv.maybe_simple_value(
@@ -105,7 +401,7 @@ POWER_CHANNEL_SCHEMA = cv.Schema(
                 accuracy_decimals=1,
                 device_class=DEVICE_CLASS_POWER,
                 state_class=STATE_CLASS_MEASUREMENT,
-            ),
+            ).extend(MULTI_RATE_SCHEMA),
             key=CONF_NAME,
         ),
         cv.Optional(CONF_APPARENT_POWER): cv.maybe_simple_value(
@@ -114,7 +410,7 @@ POWER_CHANNEL_SCHEMA = cv.Schema(
                 accuracy_decimals=1,
                 device_class=DEVICE_CLASS_APPARENT_POWER,
                 state_class=STATE_CLASS_MEASUREMENT,
-            ),
+            ).extend(MULTI_RATE_SCHEMA),
             key=CONF_NAME,
         ),
         cv.Optional(CONF_REACTIVE_POWER): cv.maybe_simple_value(
@@ -132,7 +428,7 @@ POWER_CHANNEL_SCHEMA = cv.Schema(
                 accuracy_decimals=2,
                 device_class=DEVICE_CLASS_POWER_FACTOR,
                 state_class=STATE_CLASS_MEASUREMENT,
-            ),
+            ).extend(MULTI_RATE_SCHEMA),
             key=CONF_NAME,
         ),
         cv.Optional(CONF_FREQUENCY): cv.maybe_simple_value(
@@ -140,7 +436,7 @@ POWER_CHANNEL_SCHEMA = cv.Schema(
                 unit_of_measurement=UNIT_HERTZ,
                 accuracy_decimals=2,
                 state_class=STATE_CLASS_MEASUREMENT,
-            ),
+            ).extend(MULTI_RATE_SCHEMA),
             key=CONF_NAME,
         ),
 
@@ -162,6 +458,107 @@ POWER_CHANNEL_SCHEMA = cv.Schema(
             ),
             key=CONF_NAME,
         ),
+        cv.Optional(CONF_FORWARD_REACTIVE_ENERGY): cv.maybe_simple_value(
+            sensor.sensor_schema(
+                unit_of_measurement=UNIT_VOLT_AMPS_REACTIVE_HOURS,
+                accuracy_decimals=2,
+                state_class=STATE_CLASS_TOTAL_INCREASING,
+            ),
+            key=CONF_NAME,
+        ),
+        cv.Optional(CONF_REVERSE_REACTIVE_ENERGY): cv.maybe_simple_value(
+            sensor.sensor_schema(
+                unit_of_measurement=UNIT_VOLT_AMPS_REACTIVE_HOURS,
+                accuracy_decimals=2,
+                state_class=STATE_CLASS_TOTAL_INCREASING,
+            ),
+            key=CONF_NAME,
+        ),
+        # Fundamental quantities are read from the harmonic engine of each phase
+        cv.Optional(CONF_FUNDAMENTAL_VOLTAGE): cv.maybe_simple_value(
+            sensor.sensor_schema(
+                unit_of_measurement=UNIT_VOLT,
+                accuracy_decimals=1,
+                device_class=DEVICE_CLASS_VOLTAGE,
+                state_class=STATE_CLASS_MEASUREMENT,
+            ),
+            key=CONF_NAME,
+        ),
+        cv.Optional(CONF_FUNDAMENTAL_CURRENT): cv.maybe_simple_value(
+            sensor.sensor_schema(
+                unit_of_measurement=UNIT_AMPERE,
+                accuracy_decimals=2,
+                device_class=DEVICE_CLASS_CURRENT,
+                state_class=STATE_CLASS_MEASUREMENT,
+            ),
+            key=CONF_NAME,
+        ),
+        cv.Optional(CONF_FUNDAMENTAL_ACTIVE_POWER): cv.maybe_simple_value(
+            sensor.sensor_schema(
+                unit_of_measurement=UNIT_WATT,
+                accuracy_decimals=1,
+                device_class=DEVICE_CLASS_POWER,
+                state_class=STATE_CLASS_MEASUREMENT,
+            ),
+            key=CONF_NAME,
+        ),
+        cv.Optional(CONF_FUNDAMENTAL_APPARENT_POWER): cv.maybe_simple_value(
+            sensor.sensor_schema(
+                unit_of_measurement=UNIT_VOLT_AMPS,
+                accuracy_decimals=1,
+                device_class=DEVICE_CLASS_APPARENT_POWER,
+                state_class=STATE_CLASS_MEASUREMENT,
+            ),
+            key=CONF_NAME,
+        ),
+        cv.Optional(CONF_FUNDAMENTAL_POWER_FACTOR): cv.maybe_simple_value(
+            sensor.sensor_schema(
+                accuracy_decimals=3,
+                device_class=DEVICE_CLASS_POWER_FACTOR,
+                state_class=STATE_CLASS_MEASUREMENT,
+            ),
+            key=CONF_NAME,
+        ),
+        # Largest waveform peak of the update interval. The chip tracks all phases together,
+        # a phase only counts the peak windows in which it had the largest sample.
+        cv.Optional(CONF_PEAK_CURRENT): cv.maybe_simple_value(
+            sensor.sensor_schema(
+                unit_of_measurement=UNIT_AMPERE,
+                accuracy_decimals=2,
+                device_class=DEVICE_CLASS_CURRENT,
+                state_class=STATE_CLASS_MEASUREMENT,
+            ),
+            key=CONF_NAME,
+        ),
+        cv.Optional(CONF_PEAK_VOLTAGE): cv.maybe_simple_value(
+            sensor.sensor_schema(
+                unit_of_measurement=UNIT_VOLT,
+                accuracy_decimals=1,
+                device_class=DEVICE_CLASS_VOLTAGE,
+                state_class=STATE_CLASS_MEASUREMENT,
+            ),
+            key=CONF_NAME,
+        ),
+        cv.Optional(CONF_SAG_EVENTS): EVENT_COUNTER_SCHEMA,
+        cv.Optional(CONF_OVERVOLTAGE_EVENTS): EVENT_COUNTER_SCHEMA,
+        cv.Optional(CONF_OVERCURRENT_EVENTS): EVENT_COUNTER_SCHEMA,
+        # Both angle kinds together alternate ANGLESEL, each is then published every other update
+        cv.Optional(CONF_CURRENT_ANGLE): ANGLE_SCHEMA,
+        cv.Optional(CONF_VOLTAGE_ANGLE): ANGLE_SCHEMA,
+        cv.Optional(CONF_PHASE_LOSS): PROBLEM_SCHEMA,
+        cv.Optional(CONF_REVERSE_POWER): DIRECTION_SCHEMA,
+        cv.Optional(CONF_VOLTAGE_THD): DISTORTION_SCHEMA,
+        cv.Optional(CONF_CURRENT_THD): DISTORTION_SCHEMA,
+        cv.Optional(CONF_HARMONICS): cv.ensure_list(HARMONIC_SCHEMA),
+        cv.Optional(CONF_VOLTAGE_SPECTRUM): cv.maybe_simple_value(
+            text_sensor.text_sensor_schema(),
+            key=CONF_NAME,
+        ),
+        cv.Optional(CONF_CURRENT_SPECTRUM): cv.maybe_simple_value(
+            text_sensor.text_sensor_schema(),
+            key=CONF_NAME,
+        ),
+        cv.Optional(CONF_STATISTICS): STATISTICS_SCHEMA,
 
         cv.Required(CONF_CALIBRATION): cv.Schema(
             {
@@ -182,11 +579,39 @@ CONFIG_SCHEMA = (
             cv.Optional(CONF_FREQUENCY, default="50Hz"): cv.All(
                 cv.frequency, cv.Range(min=45.0, max=66.0)
             ),
+            # VLEVEL needs U_n below the 376.6 V full scale (Equation 22)
+            cv.Optional(CONF_NOMINAL_VOLTAGE, default="230V"): cv.All(
+                cv.voltage, cv.Range(min=10.0, max=376.0)
+            ),
             cv.Required(CONF_IRQ0_PIN): pins.internal_gpio_input_pin_schema,
             cv.Required(CONF_IRQ1_PIN): pins.internal_gpio_input_pin_schema,
             cv.Optional(CONF_RESET_PIN): pins.internal_gpio_output_pin_schema,
             cv.Optional(CONF_WATCHDOG_THRESHOLD, default="5s"): cv.positive_time_period_milliseconds,
             cv.Optional(CONF_FAILURE_THRESHOLD, default=5): cv.int_range(min=1, max=255),
+            cv.Optional(CONF_VERIFY, default="per_register"): cv.enum(
+                VERIFY_MODES, lower=True
+            ),
+            cv.Optional(CONF_ENERGY_MODE, default="line_cycle"): cv.enum(
+                ENERGY_MODES, lower=True
+            ),
+            cv.Optional(
+                CONF_SLICE_BUDGET, default="2ms"
+            ): cv.positive_time_period_microseconds,
+            cv.Optional(CONF_MAX_SLICE_DURATION): sensor.sensor_schema(
+                unit_of_measurement=UNIT_MILLISECOND,
+                accuracy_decimals=2,
+                state_class=STATE_CLASS_MEASUREMENT,
+                entity_category=ENTITY_CATEGORY_DIAGNOSTIC,
+            ),
+            cv.Optional(CONF_RESTORE_ENERGY): RESTORE_ENERGY_SCHEMA,
+            cv.Optional(CONF_HARMONIC_SWEEP): HARMONIC_SWEEP_SCHEMA,
+            cv.Optional(CONF_POWER_QUALITY): POWER_QUALITY_SCHEMA,
+            cv.Optional(CONF_TOTAL_REVERSE_POWER): DIRECTION_SCHEMA,
+            # Apparent power in VA below which current, power and power factor of a phase
+            # are published as 0 once and no longer read
+            cv.Optional(CONF_NO_LOAD_LEVEL): cv.positive_float,
+            cv.Optional(CONF_WAVEFORM_CAPTURE): WAVEFORM_CAPTURE_SCHEMA,
+            cv.Optional(CONF_INTEGRITY_CHECK): INTEGRITY_CHECK_SCHEMA,
             cv.Optional(CONF_PHASE_A): POWER_CHANNEL_SCHEMA,
             cv.Optional(CONF_PHASE_B): POWER_CHANNEL_SCHEMA,
             cv.Optional(CONF_PHASE_C): POWER_CHANNEL_SCHEMA,
@@ -205,6 +630,15 @@ async def neutral_channel(config):
     sens = await sensor.new_sensor(current)
     cg.add(var.set_current(sens))
 
+    if conf := config.get(CONF_CURRENT_SUM_SAMPLE):
+        sens = await sensor.new_sensor(conf)
+        cg.add(var.set_current_sum_sample(sens))
+
+    if conf := config.get(CONF_CURRENT_MISMATCH):
+        sens = await binary_sensor.new_binary_sensor(conf)
+        cg.add(var.set_current_mismatch(sens))
+        cg.add(var.set_mismatch_level(config[CONF_MISMATCH_LEVEL]))
+
     cg.add(
         var.set_current_gain_calibration(config[CONF_CALIBRATION][CONF_CURRENT_GAIN])
     )
@@ -212,7 +646,16 @@ async def neutral_channel(config):
     return var
 
 
-async def power_channel(config):
+def harmonic_indexes(config):
+    indexes = set()
+    for channel in (CONF_PHASE_A, CONF_PHASE_B, CONF_PHASE_C):
+        if channel := config.get(channel):
+            for harmonic in channel.get(CONF_HARMONICS, []):
+                indexes.add(harmonic[CONF_INDEX])
+    return sorted(indexes)
+
+
+async def power_channel(config, harmonics):
     var = cg.new_Pvariable(config[CONF_ID])
 
     for sensor_type in (
@@ -225,11 +668,58 @@ async def power_channel(config):
         CONF_FREQUENCY,
         CONF_FORWARD_ACTIVE_ENERGY,
         CONF_REVERSE_ACTIVE_ENERGY,
+        CONF_FORWARD_REACTIVE_ENERGY,
+        CONF_REVERSE_REACTIVE_ENERGY,
+        CONF_FUNDAMENTAL_VOLTAGE,
+        CONF_FUNDAMENTAL_CURRENT,
+        CONF_FUNDAMENTAL_ACTIVE_POWER,
+        CONF_FUNDAMENTAL_APPARENT_POWER,
+        CONF_FUNDAMENTAL_POWER_FACTOR,
+        CONF_PEAK_CURRENT,
+        CONF_PEAK_VOLTAGE,
+        CONF_SAG_EVENTS,
+        CONF_OVERVOLTAGE_EVENTS,
+        CONF_OVERCURRENT_EVENTS,
+        CONF_CURRENT_ANGLE,
+        CONF_VOLTAGE_ANGLE,
+        CONF_VOLTAGE_THD,
+        CONF_CURRENT_THD,
     ):
         if conf := config.get(sensor_type):
             sens = await sensor.new_sensor(conf)
             cg.add(getattr(var, f"set_{sensor_type}")(sens))
 
+    for sensor_type in (CONF_PHASE_LOSS, CONF_REVERSE_POWER):
+        if conf := config.get(sensor_type):
+            sens = await binary_sensor.new_binary_sensor(conf)
+            cg.add(getattr(var, f"set_{sensor_type}")(sens))
+
+    for sensor_type in (CONF_VOLTAGE_SPECTRUM, CONF_CURRENT_SPECTRUM):
+        if conf := config.get(sensor_type):
+            sens = await text_sensor.new_text_sensor(conf)
+            cg.add(getattr(var, f"set_{sensor_type}")(sens))
+
+    # Order of ADE7880StatisticsQuantity
+    statistics = config.get(CONF_STATISTICS, {})
+    for quantity, sensor_type in enumerate(
+        (CONF_VOLTAGE, CONF_CURRENT, CONF_ACTIVE_POWER)
+    ):
+        if conf := statistics.get(sensor_type):
+            sensors = []
+            for stat in (CONF_MIN, CONF_MAX, CONF_MEAN, CONF_STDDEV):
+                if stat_conf := conf.get(stat):
+                    sensors.append(await sensor.new_sensor(stat_conf))
+                else:
+                    sensors.append(cg.nullptr)
+            cg.add(var.set_statistics(quantity, *sensors))
+
+    for harmonic in config.get(CONF_HARMONICS, []):
+        slot = harmonics.index(harmonic[CONF_INDEX])
+        for sensor_type in (CONF_VOLTAGE, CONF_CURRENT):
+            if conf := harmonic.get(sensor_type):
+                sens = await sensor.new_sensor(conf)
+                cg.add(getattr(var, f"set_{sensor_type}_harmonic")(slot, sens))
+
     for calib_type in (
         CONF_CURRENT_GAIN,
         CONF_VOLTAGE_GAIN,
@@ -246,7 +736,43 @@ async def power_channel(config):
     return var
 
 
+def update_intervals(config):
+    intervals = set()
+    for channel in (CONF_PHASE_A, CONF_PHASE_B, CONF_PHASE_C):
+        if channel := config.get(channel):
+            for sensor_type in MULTI_RATE_SENSORS:
+                if CONF_UPDATE_INTERVAL in channel.get(sensor_type, {}):
+                    intervals.add(
+                        channel[sensor_type][CONF_UPDATE_INTERVAL].total_milliseconds
+                    )
+    return intervals
+
+
 def final_validate(config):
+    if len(harmonic_indexes(config)) > MAX_HARMONIC_INDEXES:
+        raise cv.Invalid(
+            f"At most {MAX_HARMONIC_INDEXES} different harmonic indexes can be monitored"
+        )
+    if len(update_intervals(config)) > MAX_UPDATE_GROUPS:
+        raise cv.Invalid(
+            f"At most {MAX_UPDATE_GROUPS} different sensor update intervals are supported"
+        )
+    for channel in (CONF_PHASE_A, CONF_PHASE_B, CONF_PHASE_C):
+        if channel := config.get(channel):
+            spectrum = CONF_VOLTAGE_SPECTRUM in channel or CONF_CURRENT_SPECTRUM in channel
+            if spectrum and CONF_HARMONIC_SWEEP not in config:
+                raise cv.Invalid(f"Spectrum sensors require {CONF_HARMONIC_SWEEP}")
+            power_quality = config.get(CONF_POWER_QUALITY, {})
+            for counter, level in (
+                (CONF_SAG_EVENTS, CONF_SAG_LEVEL),
+                (CONF_OVERVOLTAGE_EVENTS, CONF_OVERVOLTAGE_LEVEL),
+                (CONF_OVERCURRENT_EVENTS, CONF_OVERCURRENT_LEVEL),
+            ):
+                if counter in channel and level not in power_quality:
+                    raise cv.Invalid(
+                        f"{counter} requires {level} in {CONF_POWER_QUALITY}"
+                    )
+
     for channel in (CONF_PHASE_A, CONF_PHASE_B, CONF_PHASE_C):
         if channel := config.get(channel):
             channel_name = channel.get(CONF_NAME)
@@ -263,6 +789,26 @@ def final_validate(config):
                 CONF_FREQUENCY,
                 CONF_FORWARD_ACTIVE_ENERGY,
                 CONF_REVERSE_ACTIVE_ENERGY,
+                CONF_FORWARD_REACTIVE_ENERGY,
+                CONF_REVERSE_REACTIVE_ENERGY,
+                CONF_FUNDAMENTAL_VOLTAGE,
+                CONF_FUNDAMENTAL_CURRENT,
+                CONF_FUNDAMENTAL_ACTIVE_POWER,
+                CONF_FUNDAMENTAL_APPARENT_POWER,
+                CONF_FUNDAMENTAL_POWER_FACTOR,
+                CONF_PEAK_CURRENT,
+                CONF_PEAK_VOLTAGE,
+                CONF_SAG_EVENTS,
+                CONF_OVERVOLTAGE_EVENTS,
+                CONF_OVERCURRENT_EVENTS,
+                CONF_CURRENT_ANGLE,
+                CONF_VOLTAGE_ANGLE,
+                CONF_PHASE_LOSS,
+                CONF_REVERSE_POWER,
+                CONF_VOLTAGE_THD,
+                CONF_CURRENT_THD,
+                CONF_VOLTAGE_SPECTRUM,
+                CONF_CURRENT_SPECTRUM,
             ):
                 if conf := channel.get(sensor_type):
                     sensor_name = conf.get(CONF_NAME)
@@ -272,16 +818,36 @@ def final_validate(config):
                     ):
                         conf[CONF_NAME] = f"{channel_name} {sensor_name}"
 
+            for quantity in channel.get(CONF_STATISTICS, {}).values():
+                for conf in quantity.values():
+                    sensor_name = conf.get(CONF_NAME)
+                    if (
+                        sensor_name
+                        and not sensor_name.startswith(channel_name)
+                    ):
+                        conf[CONF_NAME] = f"{channel_name} {sensor_name}"
+
+            for harmonic in channel.get(CONF_HARMONICS, []):
+                for sensor_type in (CONF_VOLTAGE, CONF_CURRENT):
+                    if conf := harmonic.get(sensor_type):
+                        sensor_name = conf.get(CONF_NAME)
+                        if (
+                            sensor_name
+                            and not sensor_name.startswith(channel_name)
+                        ):
+                            conf[CONF_NAME] = f"{channel_name} {sensor_name}"
+
     if channel := config.get(CONF_NEUTRAL):
         channel_name = channel.get(CONF_NAME)
-        if conf := channel.get(CONF_CURRENT):
-            sensor_name = conf.get(CONF_NAME)
-            if (
-                sensor_name
-                and channel_name
-                and not sensor_name.startswith(channel_name)
-            ):
-                conf[CONF_NAME] = f"{channel_name} {sensor_name}"
+        for sensor_type in (CONF_CURRENT, CONF_CURRENT_SUM_SAMPLE, CONF_CURRENT_MISMATCH):
+            if conf := channel.get(sensor_type):
+                sensor_name = conf.get(CONF_NAME)
+                if (
+                    sensor_name
+                    and channel_name
+                    and not sensor_name.startswith(channel_name)
+                ):
+                    conf[CONF_NAME] = f"{channel_name} {sensor_name}"
 
 
 FINAL_VALIDATE_SCHEMA = final_validate
@@ -304,15 +870,96 @@ async def to_code(config):
 
     frequency = config[CONF_FREQUENCY]
     cg.add(var.set_frequency(frequency))
+    cg.add(var.set_nominal_voltage(config[CONF_NOMINAL_VOLTAGE]))
 
     cg.add(var.set_watchdog_threshold(config[CONF_WATCHDOG_THRESHOLD]))
     cg.add(var.set_failure_threshold(config[CONF_FAILURE_THRESHOLD]))
+    cg.add(var.set_verify_mode(config[CONF_VERIFY]))
+    cg.add(var.set_energy_mode(config[CONF_ENERGY_MODE]))
+    cg.add(var.set_slice_budget(config[CONF_SLICE_BUDGET]))
+
+    if conf := config.get(CONF_MAX_SLICE_DURATION):
+        sens = await sensor.new_sensor(conf)
+        cg.add(var.set_slice_duration_sensor(sens))
+
+    if CONF_NO_LOAD_LEVEL in config:
+        cg.add(var.set_no_load_level(config[CONF_NO_LOAD_LEVEL]))
+
+    if conf := config.get(CONF_TOTAL_REVERSE_POWER):
+        sens = await binary_sensor.new_binary_sensor(conf)
+        cg.add(var.set_total_reverse_power_sensor(sens))
+
+    if conf := config.get(CONF_WAVEFORM_CAPTURE):
+        cg.add(var.set_capture_samples(conf[CONF_SAMPLES]))
+        channels = {WAVEFORM_CHANNELS[channel] for channel in conf[CONF_CHANNELS]}
+        cg.add(var.set_capture_channels(sum(1 << channel for channel in channels)))
+        cg.add(var.set_capture_log(conf[CONF_LOG]))
+
+    if conf := config.get(CONF_INTEGRITY_CHECK):
+        cg.add(var.set_integrity_interval(conf[CONF_INTERVAL]))
+        if events := conf.get(CONF_EVENTS):
+            sens = await sensor.new_sensor(events)
+            cg.add(var.set_integrity_events_sensor(sens))
+
+    if conf := config.get(CONF_RESTORE_ENERGY):
+        cg.add(var.set_restore_energy(True))
+        cg.add(var.set_flush_interval(conf[CONF_FLUSH_INTERVAL]))
+        cg.add(var.set_flush_min_interval(conf[CONF_MIN_FLUSH_INTERVAL]))
+        cg.add(var.set_flush_energy_delta(conf[CONF_ENERGY_DELTA]))
+        cg.add(var.set_flush_on_shutdown(conf[CONF_FLUSH_ON_SHUTDOWN]))
+
+    harmonics = harmonic_indexes(config)
+    for slot, index in enumerate(harmonics):
+        cg.add(var.set_harmonic_index(slot, index))
+
+    if conf := config.get(CONF_HARMONIC_SWEEP):
+        cg.add(var.set_sweep_indexes(conf[CONF_INDEXES]))
+        cg.add(var.set_harmonic_steps_per_update(conf[CONF_STEPS_PER_UPDATE]))
+
+    if conf := config.get(CONF_POWER_QUALITY):
+        if CONF_SAG_LEVEL in conf:
+            cg.add(var.set_sag_level(conf[CONF_SAG_LEVEL]))
+            cg.add(var.set_sag_cycles(conf[CONF_SAG_CYCLES]))
+        if CONF_OVERVOLTAGE_LEVEL in conf:
+            cg.add(var.set_overvoltage_level(conf[CONF_OVERVOLTAGE_LEVEL]))
+        if CONF_OVERCURRENT_LEVEL in conf:
+            cg.add(var.set_overcurrent_level(conf[CONF_OVERCURRENT_LEVEL]))
+        if CONF_PEAK_CYCLES in conf:
+            cg.add(var.set_peak_cycles(conf[CONF_PEAK_CYCLES]))
+        if event := conf.get(CONF_EVENT):
+            sens = await text_sensor.new_text_sensor(event)
+            cg.add(var.set_event_sensor(sens))
+        if CONF_ZERO_CROSSING_TIMEOUT in conf:
+            cg.add(var.set_zero_crossing_timeout(conf[CONF_ZERO_CROSSING_TIMEOUT]))
+        if sequence_error := conf.get(CONF_PHASE_SEQUENCE_ERROR):
+            sens = await binary_sensor.new_binary_sensor(sequence_error)
+            cg.add(var.set_sequence_error_sensor(sens))
 
     for channel_name in (CONF_PHASE_A, CONF_PHASE_B, CONF_PHASE_C):
         if channel := config.get(channel_name):
-            channel_var = await power_channel(channel)
+            channel_var = await power_channel(channel, harmonics)
             cg.add(getattr(var, f"set_{channel_name.replace("phase_", "channel_")}")(channel_var))
+            for sensor_type in MULTI_RATE_SENSORS:
+                conf = channel.get(sensor_type, {})
+                if CONF_UPDATE_INTERVAL in conf:
+                    sens = await cg.get_variable(conf[CONF_ID])
+                    cg.add(var.set_sensor_update_interval(sens, conf[CONF_UPDATE_INTERVAL]))
 
     if channel := config.get(CONF_NEUTRAL):
         channel_var = await neutral_channel(channel)
         cg.add(var.set_channel_n(channel_var))
+
+
+@automation.register_action(
+    "ade7880.capture_waveform",
+    CaptureWaveformAction,
+    maybe_simple_id(
+        {
+            cv.GenerateID(): cv.use_id(ADE7880),
+        }
+    ),
+)
+async def capture_waveform_to_code(config, action_id, template_arg, args):
+    var = cg.new_Pvariable(action_id, template_arg)
+    await cg.register_parented(var, config[CONF_ID])
+    return var
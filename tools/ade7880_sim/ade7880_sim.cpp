@@ -0,0 +1,566 @@
+#include "ade7880_sim.h"
+
+#include <cmath>
+
+#include "ade7880/ade7880_reg.h"
+#include "sim_hal.h"
+
+namespace ade7880_sim {
+
+using namespace esphome::ade7880;
+
+void SimPin::set_asserted(bool asserted) {
+  bool edge = asserted && !this->asserted;
+  this->asserted = asserted;
+  if(edge && this->func_ != nullptr && !this->drop_edges) {
+    this->func_(this->arg_);
+  }
+}
+
+ADE7880Sim::ADE7880Sim() { this->reset_(); }
+
+void ADE7880Sim::reset_() {
+  this->regs_.clear();
+  this->regs_[ADE7880_STATUS1] = STATUS1_RSTDONE | STATUS1_RESERVED1;
+  this->regs_[ADE7880_CHECKSUM] = 0xAFFA63B9;
+  this->regs_[ADE7880_LINECYC] = 0xFFFF;
+  this->regs_[ADE7880_ZXTOUT] = 0xFFFF;
+  this->regs_[ADE7880_COMPMODE] = 0x01FF;
+  this->regs_[ADE7880_CFMODE] = 0x0EA0;
+  this->regs_[ADE7880_CONFIG] = 0x0002;
+  this->regs_[ADE7880_MMODE] = 0x1C;
+  this->regs_[ADE7880_ACCMODE] = 0x80;
+  this->regs_[ADE7880_LCYCMODE] = 0x78;
+  this->regs_[ADE7880_CFCYC] = 0x01;
+  this->regs_[ADE7880_Version] = 0x01;
+  this->regs_[ADE7880_Reserved] = 0x08;
+  this->regs_[ADE7880_HCONFIG] = 0x08;
+  this->regs_[ADE7880_CONFIG3] = 0x01;
+  this->regs_[ADE7880_WTHR] = 0x03;
+  this->regs_[ADE7880_VARTHR] = 0x03;
+  this->regs_[ADE7880_VATHR] = 0x03;
+  this->regs_[ADE7880_HX] = 3;
+  this->regs_[ADE7880_HY] = 5;
+  this->regs_[ADE7880_HZ] = 7;
+  this->regs_[ADE7880_LPOILVL] = 0x07;
+  this->regs_[ADE7880_OILVL] = 0xFFFFFF;
+  this->regs_[ADE7880_OVLVL] = 0xFFFFFF;
+  for(int i=0; i<6; i++) {
+    this->energy_[i] = 0.0;
+    this->line_energy_[i] = 0.0;
+  }
+  this->half_cycles_ = 0.0;
+  this->pq_half_cycles_ = 0.0;
+  for(int i=0; i<3; i++) {
+    this->sag_[i] = false;
+    this->sag_count_[i] = 0;
+    this->zx_lost_us_[i] = 0.0;
+  }
+  this->positive_half_ = false;
+  this->dready_period_ = now_us / 125;
+  this->peak_count_ = 0;
+  this->ipeak_ = 0;
+  this->vpeak_ = 0;
+  this->restart_harmonics_();
+  this->update_irq_();
+}
+
+float PhaseLoad::reactive_power() const {
+  float va = this->voltage * this->current;
+  return va > std::fabs(this->power) ? std::sqrt(va * va - this->power * this->power) : 0.0f;
+}
+
+// FNV-1a over the configuration registers instead of the CRC of the chip, any change
+// of a covered register changes it
+uint32_t ADE7880Sim::checksum_() const {
+  static const uint16_t COVERED[] = {ADE7880_MASK0, ADE7880_MASK1, ADE7880_COMPMODE, ADE7880_Gain, ADE7880_CFMODE,
+                                     ADE7880_CF1DEN, ADE7880_CF2DEN, ADE7880_CF3DEN, ADE7880_CONFIG, ADE7880_MMODE,
+                                     ADE7880_ACCMODE, ADE7880_LCYCMODE, ADE7880_HSDC_CFG, ADE7880_CONFIG3};
+  uint32_t hash = 0x811C9DC5;
+  auto add = [&hash](uint32_t value) {
+    for(int b=0; b<4; b++) {
+      hash = (hash ^ ((value >> (8 * b)) & 0xFF)) * 0x01000193;
+    }
+  };
+  for(uint16_t reg=ADE7880_AIGAIN; reg<=ADE7880_NIRMSOS; reg++) {
+    add(this->get(reg));
+  }
+  for(uint16_t reg : COVERED) {
+    add(this->get(reg));
+  }
+  return hash;
+}
+
+uint32_t ADE7880Sim::get(uint16_t reg) const {
+  auto it = this->regs_.find(reg);
+  return it == this->regs_.end() ? 0 : it->second;
+}
+
+bool ADE7880Sim::is_energy_register_(uint16_t reg) const {
+  return reg >= ADE7880_AWATTHR && reg <= ADE7880_CVAHR;
+}
+
+void ADE7880Sim::account_(size_t len) {
+  // START, address byte, data bytes with ACK bits and STOP/repeated START
+  this->stats.transactions++;
+  this->stats.bytes += len + 1;
+  double us = (2.0 + 9.0 * (len + 1)) * 1e6 / this->bus_frequency_;
+  this->stats.bus_us += us;
+  // The blocking transfer advances the CPU clock
+  this->pending_us_ += us;
+  now_us += (uint64_t)this->pending_us_;
+  this->pending_us_ -= (uint64_t)this->pending_us_;
+}
+
+ErrorCode ADE7880Sim::write(uint8_t address, const uint8_t *data, size_t len, bool stop) {
+  this->account_(len);
+  if(len < 2) {
+    return esphome::i2c::ERROR_INVALID_ARGUMENT;
+  }
+  this->pointer_ = (data[0] << 8) | data[1];
+  if(len == 2) {
+    return esphome::i2c::ERROR_OK;
+  }
+
+  // Each register write is addressed individually
+  uint8_t size = ade_reg_size(this->pointer_);
+  if(len != 2u + size) {
+    return esphome::i2c::ERROR_INVALID_ARGUMENT;
+  }
+  uint32_t value = 0;
+  for(size_t i=2; i<len; i++) {
+    value = (value << 8) | data[i];
+  }
+  this->write_register_(this->pointer_, value);
+  return esphome::i2c::ERROR_OK;
+}
+
+void ADE7880Sim::write_register_(uint16_t reg, uint32_t value) {
+  uint8_t size = ade_reg_size(reg);
+  this->regs_[ADE7880_LAST_OP] = 0xCA;
+  this->regs_[ADE7880_LAST_ADD] = reg;
+  this->regs_[size == 4 ? ADE7880_LAST_RWDATA32 : size == 2 ? ADE7880_LAST_RWDATA16 : ADE7880_LAST_RWDATA8] = value;
+
+  switch(reg) {
+    case ADE7880_STATUS0:
+    case ADE7880_STATUS1:
+      // Write 1 to clear
+      this->regs_[reg] &= ~value;
+      if(reg == ADE7880_STATUS1) {
+        this->regs_[reg] |= STATUS1_RESERVED1;
+        // The phase bits go with their STATUS1 flag
+        uint32_t phstatus = this->get(ADE7880_PHSTATUS);
+        if(value & STATUS1_SAG) {
+          phstatus &= ~(PHSTATUS_VSPHASE_A | PHSTATUS_VSPHASE_B | PHSTATUS_VSPHASE_C);
+        }
+        if(value & STATUS1_OV) {
+          phstatus &= ~(PHSTATUS_OVPHASE_A | PHSTATUS_OVPHASE_B | PHSTATUS_OVPHASE_C);
+        }
+        if(value & STATUS1_OI) {
+          phstatus &= ~(PHSTATUS_OIPHASE_A | PHSTATUS_OIPHASE_B | PHSTATUS_OIPHASE_C);
+        }
+        this->regs_[ADE7880_PHSTATUS] = phstatus;
+      }
+      break;
+    case ADE7880_HCONFIG:
+    case ADE7880_HX:
+    case ADE7880_HY:
+    case ADE7880_HZ:
+      // Any harmonic setup change restarts the harmonic block
+      this->regs_[reg] = value;
+      this->restart_harmonics_();
+      break;
+    case ADE7880_CONFIG:
+      if(value & 0x80) {
+        this->resets++;
+        this->reset_();
+        return;
+      }
+      this->regs_[reg] = value;
+      break;
+    default:
+      this->regs_[reg] = value;
+      break;
+  }
+  this->update_irq_();
+}
+
+ErrorCode ADE7880Sim::read(uint8_t address, uint8_t *data, size_t len) {
+  this->account_(len);
+  // The waveform registers change during long transfers, the bus time already passed
+  this->update_waveforms_();
+  if((this->pointer_ >= ADE7880_IAWV && this->pointer_ <= ADE7880_VCWV) ||
+     (this->pointer_ >= ADE7880_AIRMS && this->pointer_ <= ADE7880_ISUM)) {
+    this->sample_waveforms_();
+  }
+  if(this->pointer_ == ADE7880_CHECKSUM) {
+    this->regs_[ADE7880_CHECKSUM] = this->checksum_();
+  }
+  uint8_t size = ade_reg_size(this->pointer_);
+  if(!size || len % size) {
+    return esphome::i2c::ERROR_INVALID_ARGUMENT;
+  }
+  if(this->pointer_ >= ADE7880_FVRMS && this->pointer_ <= ADE7880_HZIHD && this->get(ADE7880_VLEVEL) == 0) {
+    // Without VLEVEL (Equation 22) the harmonic block results are meaningless
+    return esphome::i2c::ERROR_INVALID_ARGUMENT;
+  }
+
+  // Consecutive registers are returned for reads longer than one register
+  uint16_t reg = this->pointer_;
+  uint32_t value = 0;
+  for(size_t i=0; i<len; i+=size, reg++) {
+    value = this->get(reg);
+    for(uint8_t b=0; b<size; b++) {
+      data[i + b] = (value >> (8 * (size - 1 - b))) & 0xFF;
+    }
+    if(this->is_energy_register_(reg) && (this->get(ADE7880_LCYCMODE) & LCYCMODE_RSTREAD)) {
+      this->regs_[reg] = 0;
+    }
+  }
+  reg--;
+
+  // Reading the LAST_* registers doesn't update them
+  switch(reg) {
+    case ADE7880_LAST_OP:
+    case ADE7880_LAST_ADD:
+    case ADE7880_LAST_RWDATA8:
+    case ADE7880_LAST_RWDATA16:
+    case ADE7880_LAST_RWDATA32:
+      break;
+    default:
+      this->regs_[ADE7880_LAST_OP] = 0x35;
+      this->regs_[ADE7880_LAST_ADD] = reg;
+      this->regs_[size == 4 ? ADE7880_LAST_RWDATA32 : size == 2 ? ADE7880_LAST_RWDATA16 : ADE7880_LAST_RWDATA8] = value;
+      break;
+  }
+  return esphome::i2c::ERROR_OK;
+}
+
+void ADE7880Sim::update_measurements_() {
+  static const uint16_t IRMS[3] = {ADE7880_AIRMS, ADE7880_BIRMS, ADE7880_CIRMS};
+  static const uint16_t VRMS[3] = {ADE7880_AVRMS, ADE7880_BVRMS, ADE7880_CVRMS};
+  float neutral = 0.0f;
+  float sum = 0.0f;
+  uint32_t phsign = 0;
+  uint32_t phnoload = 0;
+  // xNOLOAD levels relative to PMAX in xWATT LSB, 0 disables the detection
+  const float noload_lsb = 27059678.0f / 65536.0f;
+  for(int i=0; i<3; i++) {
+    const PhaseLoad &load = this->load_[i];
+    float va = load.voltage * load.current;
+    sum += load.power;
+    if(load.power < 0.0f) {
+      phsign |= PHSIGN_AWSIGN << i;
+    }
+    if(std::fabs(load.power) * 100.0f < this->get(ADE7880_APNOLOAD) * noload_lsb &&
+       load.reactive_power() * 100.0f < this->get(ADE7880_VARNOLOAD) * noload_lsb) {
+      phnoload |= PHNOLOAD_NLPHASE_A << i;
+    }
+    if(va * 100.0f < this->get(ADE7880_VANOLOAD) * noload_lsb) {
+      phnoload |= PHNOLOAD_VANLPHASE_A << i;
+    }
+    this->regs_[IRMS[i]] = (uint32_t)(load.current * 100000.0f) & 0xFFFFFF;
+    this->regs_[VRMS[i]] = (uint32_t)(load.voltage * 10000.0f) & 0xFFFFFF;
+    this->regs_[ADE7880_AWATT + i] = (uint32_t)(int32_t)(load.power * 100.0f);
+    this->regs_[ADE7880_AVA + i] = (uint32_t)(int32_t)(va * 100.0f);
+    this->regs_[ADE7880_APF + i] = (uint16_t)(int16_t)(va > 0 ? load.power / va * 0x7FFF : 0x7FFF);
+    this->regs_[ADE7880_APERIOD + i] = (uint16_t)(256000.0f / this->line_frequency_);
+    neutral += load.current;
+  }
+  this->regs_[ADE7880_NIRMS] = (uint32_t)(neutral / 3.0f * 100000.0f) & 0xFFFFFF;
+
+  // CF1 sums all phases with the default TERMSEL1, a sign change raises REVAPx/REVPSUM1
+  if(sum < 0.0f) {
+    phsign |= PHSIGN_SUM1SIGN;
+  }
+  uint32_t changed = phsign ^ this->get(ADE7880_PHSIGN);
+  for(int i=0; i<3; i++) {
+    if(changed & (PHSIGN_AWSIGN << i)) {
+      this->regs_[ADE7880_STATUS0] |= STATUS0_REVAPA << i;
+    }
+  }
+  if(changed & PHSIGN_SUM1SIGN) {
+    this->regs_[ADE7880_STATUS0] |= STATUS0_REVPSUM1;
+  }
+  this->regs_[ADE7880_PHSIGN] = phsign;
+  this->regs_[ADE7880_PHNOLOAD] = phnoload;
+
+  // ANGLEx in 256 kHz clocks: voltage to current of each phase, or from the voltage of the
+  // preceding phase, 120 degrees in A-B-C sequence and 240 when reversed
+  uint32_t anglesel = this->get(ADE7880_COMPMODE) & COMPMODE_ANGLESEL_11;
+  float clocks_per_degree = 256000.0f / this->line_frequency_ / 360.0f;
+  for(int i=0; i<3; i++) {
+    const PhaseLoad &load = this->load_[i];
+    float degrees = 0.0f;
+    if(anglesel == COMPMODE_ANGLESEL_00) {
+      float va = load.voltage * load.current;
+      float pf = va > 0 ? std::fabs(load.power) / va : 1.0f;
+      degrees = std::acos(pf > 1.0f ? 1.0f : pf) * 57.29578f;
+    }
+    else if(anglesel == COMPMODE_ANGLESEL_01) {
+      bool present = load.voltage > 1.0f && this->load_[(i + 2) % 3].voltage > 1.0f;
+      degrees = present ? (this->reverse_sequence_ ? 240.0f : 120.0f) : 0.0f;
+    }
+    else {
+      continue;
+    }
+    this->regs_[ADE7880_ANGLE0 + i] = (uint16_t)(degrees * clocks_per_degree);
+  }
+}
+
+void ADE7880Sim::restart_harmonics_() {
+  static const double HSTIME_US[4] = {500000.0, 750000.0, 1000000.0, 1250000.0};
+  uint32_t hconfig = this->get(ADE7880_HCONFIG);
+  this->harmonic_us_ = (hconfig & HCONFIG_HRCFG) ? 0.0 : HSTIME_US[(hconfig >> 3) & 0x3];
+}
+
+// Relative amplitude of harmonic n, falling with 1/n over the odd harmonics and scaled
+// so the distortion of all harmonics adds up to the THD
+static double harmonic_share(uint8_t n) {
+  if(n < 3 || n % 2 == 0) {
+    return 0.0;
+  }
+  double sum = 0.0;
+  for(int k=3; k<64; k+=2) {
+    sum += 1.0 / (k * k);
+  }
+  return 1.0 / n / std::sqrt(sum);
+}
+
+void ADE7880Sim::update_harmonics_() {
+  static const double HRATE_US[7] = {125.0, 250.0, 1000.0, 16000.0, 128000.0, 512000.0, 1024000.0};
+  uint32_t hconfig = this->get(ADE7880_HCONFIG);
+  uint8_t hrate = (hconfig >> 5) & 0x7;
+  uint8_t phase = (hconfig >> 1) & 0x3;
+  if(hrate == 7 || phase > 2) {
+    return;
+  }
+  const PhaseLoad &load = this->load_[phase];
+  const double format = 1 << 21;  // 3.21
+  this->regs_[ADE7880_VTHD] = (uint32_t)(load.voltage_thd / 100.0 * format);
+  this->regs_[ADE7880_ITHD] = (uint32_t)(load.current_thd / 100.0 * format);
+  for(int slot=0; slot<3; slot++) {
+    double share = harmonic_share(this->get(ADE7880_HX + slot));
+    this->regs_[ADE7880_HXVHD + 8 * slot] = (uint32_t)(load.voltage_thd / 100.0 * share * format);
+    this->regs_[ADE7880_HXIHD + 8 * slot] = (uint32_t)(load.current_thd / 100.0 * share * format);
+  }
+  // Fundamental results, the harmonic content is small enough to ignore here
+  float va = load.voltage * load.current;
+  this->regs_[ADE7880_FVRMS] = (uint32_t)(load.voltage * 10000.0f) & 0xFFFFFF;
+  this->regs_[ADE7880_FIRMS] = (uint32_t)(load.current * 100000.0f) & 0xFFFFFF;
+  this->regs_[ADE7880_FWATT] = (uint32_t)(int32_t)(load.power * 100.0f) & 0xFFFFFF;
+  this->regs_[ADE7880_FVAR] = (uint32_t)(int32_t)(load.reactive_power() * 100.0f) & 0xFFFFFF;
+  this->regs_[ADE7880_FVA] = (uint32_t)(int32_t)(va * 100.0f) & 0xFFFFFF;
+  this->regs_[ADE7880_FPF] = (uint32_t)(int32_t)((va > 0 ? load.power / va : 1.0) * format) & 0xFFFFFF;
+  this->regs_[ADE7880_STATUS0] |= STATUS0_HREADY;
+  this->harmonic_us_ += HRATE_US[hrate];
+}
+
+// Sum of the fundamental and the odd harmonics of a sine with the given rms and THD in %
+static double distorted_wave(double rms, double thd, double theta) {
+  double value = std::sin(theta);
+  for(int n=3; n<16; n+=2) {
+    value += thd / 100.0 * harmonic_share(n) * std::sin(n * theta);
+  }
+  return rms * 1.41421356 * value;
+}
+
+void ADE7880Sim::update_waveforms_() {
+  uint64_t period = now_us / 125;
+  if(!(this->get(ADE7880_Run) & RUN_START) || period == this->dready_period_) {
+    return;
+  }
+  this->dready_period_ = period;
+  this->regs_[ADE7880_STATUS0] |= STATUS0_DREADY;
+  this->update_irq_();
+}
+
+void ADE7880Sim::sample_waveforms_() {
+  // Samples of the last DSP period, in xVRMS and xIRMS LSB. C follows A when reversed.
+  const double degree = 3.14159265 / 180.0;
+  double theta = 2.0 * 3.14159265 * this->line_frequency_ * (this->dready_period_ * 125e-6);
+  double neutral = 0.0;
+  double sum = 0.0;
+  for(int i=0; i<3; i++) {
+    const PhaseLoad &load = this->load_[i];
+    double offset = (this->reverse_sequence_ ? 120.0 : -120.0) * i * degree;
+    float va = load.voltage * load.current;
+    double lag = std::acos(va > 0 ? std::fabs(load.power) / va : 1.0) + (load.power < 0 ? 180.0 * degree : 0.0);
+    double v = distorted_wave(load.voltage, load.voltage_thd, theta + offset);
+    double a = distorted_wave(load.current, load.current_thd, theta + offset - lag);
+    if(i == 0) {
+      a += this->leakage_ * 1.41421356 * std::sin(theta);
+    }
+    neutral -= a;
+    sum += a;
+    this->regs_[ADE7880_VAWV + i] = (uint32_t)(int32_t)(v * 10000.0);
+    this->regs_[ADE7880_IAWV + i] = (uint32_t)(int32_t)(a * 100000.0);
+  }
+  // The leakage returns outside the neutral
+  neutral += this->leakage_ * 1.41421356 * std::sin(theta);
+  this->regs_[ADE7880_INWV] = (uint32_t)(int32_t)(neutral * 100000.0);
+  // ISUM is the sum of the phase current samples
+  this->regs_[ADE7880_ISUM] = (uint32_t)(int32_t)(sum * 100000.0) & 0xFFFFFFF;
+}
+
+static uint16_t energy_register(int i) {
+  return i < 3 ? ADE7880_AWATTHR + i : ADE7880_AFVARHR + i - 3;
+}
+
+void ADE7880Sim::update_power_quality_() {
+  // Waveform samples share the LSB weight of xVRMS and xIRMS, peaks of a sine are rms * sqrt(2)
+  uint32_t status1 = 0;
+  uint32_t phstatus = this->get(ADE7880_PHSTATUS);
+  uint32_t saglvl = this->get(ADE7880_SAGLVL);
+  uint32_t sagcyc = this->get(ADE7880_SAGCYC);
+  double half_us = 1e6 / (2.0 * this->line_frequency_);
+  double zxtout_us = this->get(ADE7880_ZXTOUT) * 62.5;
+  this->positive_half_ = !this->positive_half_;
+  for(int i=0; i<3; i++) {
+    const PhaseLoad &load = this->load_[i];
+    uint32_t vpeak = (uint32_t)(load.voltage * 1.41421356f * 10000.0f) & 0xFFFFFF;
+    uint32_t ipeak = (uint32_t)(load.current * 1.41421356f * 100000.0f) & 0xFFFFFF;
+
+    // A sag starts and ends after SAGCYC half cycles below, respectively above SAGLVL
+    bool below = vpeak < saglvl;
+    if(saglvl > 0 && sagcyc > 0 && below != this->sag_[i]) {
+      if(++this->sag_count_[i] >= sagcyc) {
+        this->sag_[i] = below;
+        this->sag_count_[i] = 0;
+        status1 |= STATUS1_SAG;
+        phstatus |= PHSTATUS_VSPHASE_A << i;
+      }
+    }
+    else {
+      this->sag_count_[i] = 0;
+    }
+    // ZXSEL of the voltage zero crossings is not modelled, every half cycle has one
+    if(load.voltage > 1.0f) {
+      status1 |= STATUS1_ZXVA << i;
+      this->zx_lost_us_[i] = 0.0;
+    }
+    else if(this->zx_lost_us_[i] < zxtout_us) {
+      this->zx_lost_us_[i] += half_us;
+      if(this->zx_lost_us_[i] >= zxtout_us) {
+        status1 |= STATUS1_ZXTOVA << i;
+      }
+    }
+    if(vpeak > this->get(ADE7880_OVLVL)) {
+      status1 |= STATUS1_OV;
+      phstatus |= PHSTATUS_OVPHASE_A << i;
+    }
+    if(ipeak > this->get(ADE7880_OILVL)) {
+      status1 |= STATUS1_OI;
+      phstatus |= PHSTATUS_OIPHASE_A << i;
+    }
+
+    // Only the phases selected by MMODE.PEAKSEL feed IPEAK/VPEAK
+    if(!(this->get(ADE7880_MMODE) & (MMODE_PEAKSEL_A << i))) {
+      continue;
+    }
+    if(ipeak > (this->ipeak_ & PEAK_VALUE)) {
+      this->ipeak_ = ipeak | (PEAK_PHASE_A << i);
+    }
+    if(vpeak > (this->vpeak_ & PEAK_VALUE)) {
+      this->vpeak_ = vpeak | (PEAK_PHASE_A << i);
+    }
+  }
+
+  uint32_t isumlvl = this->get(ADE7880_ISUMLVL);
+  if(isumlvl > 0 && this->leakage_ * 1.41421356f * 100000.0f > isumlvl) {
+    status1 |= STATUS1_MISMTCH;
+  }
+
+  // SEQERR once per line cycle, on the negative-to-positive crossing of phase A
+  if(this->reverse_sequence_ && this->positive_half_ && this->load_[0].voltage > 1.0f) {
+    status1 |= STATUS1_SEQERR;
+  }
+
+  uint32_t peakcyc = this->get(ADE7880_PEAKCYC);
+  if(peakcyc > 0 && ++this->peak_count_ >= peakcyc) {
+    this->regs_[ADE7880_IPEAK] = this->ipeak_;
+    this->regs_[ADE7880_VPEAK] = this->vpeak_;
+    this->ipeak_ = 0;
+    this->vpeak_ = 0;
+    this->peak_count_ = 0;
+    status1 |= STATUS1_PKI | STATUS1_PKV;
+  }
+  this->regs_[ADE7880_STATUS1] |= status1;
+  this->regs_[ADE7880_PHSTATUS] = phstatus;
+}
+
+void ADE7880Sim::advance(uint32_t us) {
+  if(!(this->get(ADE7880_Run) & RUN_START)) {
+    return;
+  }
+  this->update_measurements_();
+  this->update_waveforms_();
+
+  double dt = us / 1e6;
+  uint32_t lcycmode = this->get(ADE7880_LCYCMODE);
+  uint32_t phnoload = this->get(ADE7880_PHNOLOAD);
+  for(int i=0; i<6; i++) {
+    const PhaseLoad &load = this->load_[i % 3];
+    bool reactive = i >= 3;
+    // Below APNOLOAD and VARNOLOAD the active and reactive energy don't accumulate
+    if(phnoload & (PHNOLOAD_NLPHASE_A << (i % 3))) {
+      continue;
+    }
+    // xWATTHR and xFVARHR LSB per second, see ADE7880::read_energy_()
+    double inc = (reactive ? load.reactive_power() : load.power) * 100.0 * 1000.0 / 24576.0 * dt;
+    if(lcycmode & (reactive ? LCYCMODE_LVAR : LCYCMODE_LWATT)) {
+      this->line_energy_[i] += inc;
+      continue;
+    }
+    this->energy_[i] += inc;
+    int32_t whole = (int32_t)this->energy_[i];
+    this->energy_[i] -= whole;
+    uint16_t addr = energy_register(i);
+    int32_t reg = (int32_t)this->get(addr) + whole;
+    this->regs_[addr] = (uint32_t)reg;
+    if(reg >= (1 << 30) || reg <= -(1 << 30)) {
+      this->regs_[ADE7880_STATUS0] |= reactive ? STATUS0_FREHF : STATUS0_AEHF;
+    }
+  }
+
+  this->harmonic_us_ -= us;
+  if(this->harmonic_us_ <= 0.0) {
+    this->update_harmonics_();
+    // Updates faster than the simulation step collapse into one
+    if(this->harmonic_us_ <= 0.0) {
+      this->harmonic_us_ = 0.0;
+    }
+  }
+
+  this->pq_half_cycles_ += dt * 2.0 * this->line_frequency_;
+  while(this->pq_half_cycles_ >= 1.0) {
+    this->pq_half_cycles_ -= 1.0;
+    this->update_power_quality_();
+  }
+
+  this->half_cycles_ += dt * 2.0 * this->line_frequency_;
+  uint32_t linecyc = this->get(ADE7880_LINECYC);
+  if(this->half_cycles_ >= linecyc) {
+    this->half_cycles_ -= linecyc;
+    if(lcycmode & (LCYCMODE_LWATT | LCYCMODE_LVAR | LCYCMODE_LVA)) {
+      for(int i=0; i<6; i++) {
+        if(!(lcycmode & (i >= 3 ? LCYCMODE_LVAR : LCYCMODE_LWATT))) {
+          continue;
+        }
+        int32_t whole = (int32_t)this->line_energy_[i];
+        this->line_energy_[i] -= whole;
+        this->regs_[energy_register(i)] = (uint32_t)whole;
+      }
+      this->regs_[ADE7880_STATUS0] |= STATUS0_LENERGY;
+    }
+  }
+  this->update_irq_();
+}
+
+void ADE7880Sim::update_irq_() {
+  this->irq0.set_asserted(this->get(ADE7880_STATUS0) & this->get(ADE7880_MASK0));
+  // RSTDONE can't be masked
+  this->irq1.set_asserted(this->get(ADE7880_STATUS1) & (this->get(ADE7880_MASK1) | STATUS1_RSTDONE));
+}
+
+} // namespace ade7880_sim
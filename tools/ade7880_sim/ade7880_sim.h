@@ -0,0 +1,124 @@
+#pragma once
+
+#include <map>
+
+#include "esphome/core/hal.h"
+#include "esphome/components/i2c/i2c.h"
+
+namespace ade7880_sim {
+
+using esphome::i2c::ErrorCode;
+
+struct BusStats {
+  uint32_t transactions{0};
+  uint32_t bytes{0};
+  double bus_us{0.0};
+};
+
+// Interrupt pin driven by the register model, IRQn is active low
+class SimPin : public esphome::InternalGPIOPin {
+ public:
+  bool digital_read() override { return !this->asserted; }
+  void attach_interrupt(void (*func)(void *), void *arg, esphome::gpio::InterruptType type) const override {
+    auto *self = const_cast<SimPin *>(this);
+    self->func_ = func;
+    self->arg_ = arg;
+  }
+  void set_asserted(bool asserted);
+
+  bool asserted{false};
+  // Edges are not delivered to the handler, a glitch on the interrupt line
+  bool drop_edges{false};
+
+ protected:
+  void (*func_)(void *){nullptr};
+  void *arg_{nullptr};
+};
+
+struct PhaseLoad {
+  float voltage{230.0f};
+  float current{0.0f};
+  float power{0.0f};
+  // Fundamental reactive power, the rest of the apparent power
+  float reactive_power() const;
+  // Total harmonic distortion in %, spread over the odd harmonics
+  float voltage_thd{3.0f};
+  float current_thd{30.0f};
+};
+
+// Register level model of the ADE7880 behind an I2C bus
+class ADE7880Sim : public esphome::i2c::I2CBus {
+ public:
+  ADE7880Sim();
+
+  ErrorCode read(uint8_t address, uint8_t *data, size_t len) override;
+  ErrorCode write(uint8_t address, const uint8_t *data, size_t len, bool stop) override;
+
+  void set_bus_frequency(float bus_frequency) { this->bus_frequency_ = bus_frequency; }
+  void set_line_frequency(float line_frequency) { this->line_frequency_ = line_frequency; }
+  void set_load(uint8_t phase, PhaseLoad load) { this->load_[phase] = load; }
+  // Phase C voltage follows phase A instead of phase B
+  void set_reverse_sequence(bool reverse_sequence) { this->reverse_sequence_ = reverse_sequence; }
+  // Current in A returning outside the neutral, a mismatch between ISUM and the neutral current
+  void set_leakage(float leakage) { this->leakage_ = leakage; }
+
+  // Brown-out: all registers back to their defaults, the DSP stops
+  void power_on_reset() { this->reset_(); }
+
+  // Advance DSP time, accumulating energy and raising line-cycle interrupts
+  void advance(uint32_t us);
+
+  uint32_t get(uint16_t reg) const;
+  // Number of software resets through CONFIG
+  uint32_t resets{0};
+  void set(uint16_t reg, uint32_t value) { this->regs_[reg] = value; }
+
+  SimPin irq0;
+  SimPin irq1;
+  BusStats stats;
+
+ protected:
+  void reset_();
+  void update_measurements_();
+  void update_harmonics_();
+  void update_power_quality_();
+  void update_waveforms_();
+  void sample_waveforms_();
+  uint32_t checksum_() const;
+  void restart_harmonics_();
+  void update_irq_();
+  void account_(size_t len);
+  void write_register_(uint16_t reg, uint32_t value);
+  bool is_energy_register_(uint16_t reg) const;
+
+  std::map<uint16_t, uint32_t> regs_;
+  uint16_t pointer_{0};
+  float bus_frequency_{400000.0f};
+  double pending_us_{0.0};
+  float line_frequency_{50.0f};
+  PhaseLoad load_[3];
+  bool reverse_sequence_{false};
+  float leakage_{0.0f};
+
+  // Energy not yet transferred to the xWATTHR (0-2) and xFVARHR (3-5) registers, in register LSBs
+  double energy_[6]{};
+  // Line-cycle accumulation since the last LENERGY
+  double line_energy_[6]{};
+  double half_cycles_{0.0};
+  // Time until the harmonic block output registers are updated next
+  double harmonic_us_{0.0};
+  // Power quality detection runs once per half line cycle
+  double pq_half_cycles_{0.0};
+  bool sag_[3]{};
+  uint8_t sag_count_[3]{};
+  uint32_t peak_count_{0};
+  uint32_t ipeak_{0};
+  uint32_t vpeak_{0};
+  // Time without voltage zero crossings, ZXTOVx fires once when it reaches ZXTOUT
+  double zx_lost_us_[3]{};
+  bool positive_half_{false};
+  // Last 125 us DSP period, DREADY is raised and xWV are sampled once per period
+  uint64_t dready_period_{0};
+};
+
+} // namespace ade7880_sim
@@ -0,0 +1,1133 @@
+// Host benchmark for the ADE7880 component: reports I2C transactions, bytes
+// and simulated bus time per update() and per LENERGY interrupt, the
+// energy error when loop() stalls and the energy persistence flush rate.
+// Transfer counts and decoded values are checked against the expected ones,
+// a mismatch is reported on stderr and the bench exits non-zero.
+//
+//   make -C tools/ade7880_sim run
+
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "ade7880/ade7880.h"
+#include "ade7880/ade7880_reg.h"
+#include "ade7880_sim.h"
+#include "sim_hal.h"
+
+using namespace esphome;
+using namespace esphome::ade7880;
+using ade7880_sim::ADE7880Sim;
+using ade7880_sim::BusStats;
+
+uint64_t ade7880_sim::now_us = 0;
+
+static uint32_t failures = 0;
+
+// Counts are expected exactly, decoded values within the tolerance. NAN expects NAN.
+static void expect(const char *name, const char *what, double actual, double expected, double tolerance = 0.0) {
+  bool ok = std::isnan(expected) ? std::isnan(actual) : std::fabs(actual - expected) <= tolerance;
+  if(!ok) {
+    fprintf(stderr, "FAIL %s %s: %g, expected %g\n", name, what, actual, expected);
+    failures++;
+  }
+}
+
+class BenchADE7880 : public ADE7880 {
+ public:
+  bool ready() const { return (this->setup_state_ & INIT_DONE) && this->store_.skip_cycles == 0; }
+  bool irq_pending() const { return this->store_.irq0_state > 0; }
+  bool publishing() const { return this->block_index_ < ADE7880_BLOCK_COUNT; }
+};
+
+struct Fixture {
+  ADE7880Sim sim;
+  BenchADE7880 ade;
+  PowerChannel channels[3];
+  NeutralChannel neutral;
+  sensor::Sensor sensors[3][9];
+  sensor::Sensor neutral_current;
+  sensor::Sensor slice_duration;
+  // THD and HX/HY/HZ distortion per phase, voltage and current
+  sensor::Sensor thd[3][2];
+  sensor::Sensor harmonics[3][3][2];
+  text_sensor::TextSensor spectrum[3][2];
+  // Reactive power, fundamental V, I, P, S, PF and forward/reverse VARh per phase
+  sensor::Sensor fundamental[3][8];
+  // Peak current and voltage per phase
+  sensor::Sensor peaks[3][2];
+  // Sag, overvoltage and overcurrent event counters per phase
+  sensor::Sensor events[3][3];
+  text_sensor::TextSensor event;
+  // Voltage to current and voltage to voltage angles per phase
+  sensor::Sensor angles[3][2];
+  binary_sensor::BinarySensor phase_loss[3];
+  binary_sensor::BinarySensor sequence_error;
+  binary_sensor::BinarySensor reverse_power[3];
+  binary_sensor::BinarySensor total_reverse_power;
+  sensor::Sensor current_sum_sample;
+  binary_sensor::BinarySensor current_mismatch;
+
+  explicit Fixture(ADE7880VerifyMode verify_mode, ADE7880EnergyMode energy_mode = ENERGY_LINE_CYCLE) {
+    static const float POWER[3] = {1500.0f, 230.0f, 15.0f};
+    for(int i=0; i<3; i++) {
+      PowerChannel &channel = this->channels[i];
+      sensor::Sensor *s = this->sensors[i];
+      channel.set_voltage(&s[0]);
+      channel.set_current(&s[1]);
+      channel.set_active_power(&s[2]);
+      channel.set_apparent_power(&s[3]);
+      channel.set_power_factor(&s[5]);
+      channel.set_frequency(&s[6]);
+      channel.set_forward_active_energy(&s[7]);
+      channel.set_reverse_active_energy(&s[8]);
+      this->sim.set_load(i, {230.0f, POWER[i] / 230.0f / 0.95f, POWER[i]});
+    }
+    this->neutral.set_current(&this->neutral_current);
+
+    this->ade.set_i2c_bus(&this->sim);
+    this->ade.set_i2c_address(0x38);
+    this->ade.set_irq0_pin(&this->sim.irq0);
+    this->ade.set_irq1_pin(&this->sim.irq1);
+    this->ade.set_frequency(50.0f);
+    this->ade.set_verify_mode(verify_mode);
+    this->ade.set_energy_mode(energy_mode);
+    this->ade.set_slice_duration_sensor(&this->slice_duration);
+    this->ade.set_channel_a(&this->channels[0]);
+    this->ade.set_channel_b(&this->channels[1]);
+    this->ade.set_channel_c(&this->channels[2]);
+    this->ade.set_channel_n(&this->neutral);
+  }
+
+  void enable_sweep(const std::vector<uint8_t> &indexes, uint8_t steps_per_update) {
+    for(int i=0; i<3; i++) {
+      this->channels[i].set_voltage_spectrum(&this->spectrum[i][0]);
+      this->channels[i].set_current_spectrum(&this->spectrum[i][1]);
+    }
+    this->ade.set_sweep_indexes(indexes);
+    this->ade.set_harmonic_steps_per_update(steps_per_update);
+  }
+
+  void enable_fundamental() {
+    for(int i=0; i<3; i++) {
+      sensor::Sensor *s = this->fundamental[i];
+      this->channels[i].set_reactive_power(&s[0]);
+      this->channels[i].set_fundamental_voltage(&s[1]);
+      this->channels[i].set_fundamental_current(&s[2]);
+      this->channels[i].set_fundamental_active_power(&s[3]);
+      this->channels[i].set_fundamental_apparent_power(&s[4]);
+      this->channels[i].set_fundamental_power_factor(&s[5]);
+      this->channels[i].set_forward_reactive_energy(&s[6]);
+      this->channels[i].set_reverse_reactive_energy(&s[7]);
+    }
+  }
+
+  void enable_peaks() {
+    for(int i=0; i<3; i++) {
+      this->channels[i].set_peak_current(&this->peaks[i][0]);
+      this->channels[i].set_peak_voltage(&this->peaks[i][1]);
+    }
+  }
+
+  void enable_events() {
+    for(int i=0; i<3; i++) {
+      this->channels[i].set_sag_events(&this->events[i][0]);
+      this->channels[i].set_overvoltage_events(&this->events[i][1]);
+      this->channels[i].set_overcurrent_events(&this->events[i][2]);
+    }
+    this->ade.set_sag_level(207.0f);
+    this->ade.set_sag_cycles(2);
+    this->ade.set_overvoltage_level(264.0f);
+    this->ade.set_overcurrent_level(20.0f);
+    this->ade.set_event_sensor(&this->event);
+  }
+
+  void enable_zero_crossing() {
+    for(int i=0; i<3; i++) {
+      this->channels[i].set_current_angle(&this->angles[i][0]);
+      this->channels[i].set_voltage_angle(&this->angles[i][1]);
+      this->channels[i].set_phase_loss(&this->phase_loss[i]);
+    }
+    this->ade.set_zero_crossing_timeout(100);
+    this->ade.set_sequence_error_sensor(&this->sequence_error);
+    this->ade.set_event_sensor(&this->event);
+  }
+
+  void enable_direction() {
+    for(int i=0; i<3; i++) {
+      this->channels[i].set_reverse_power(&this->reverse_power[i]);
+    }
+    this->ade.set_total_reverse_power_sensor(&this->total_reverse_power);
+  }
+
+  void enable_harmonics() {
+    for(int i=0; i<3; i++) {
+      this->channels[i].set_voltage_thd(&this->thd[i][0]);
+      this->channels[i].set_current_thd(&this->thd[i][1]);
+      for(int slot=0; slot<3; slot++) {
+        this->channels[i].set_voltage_harmonic(slot, &this->harmonics[i][slot][0]);
+        this->channels[i].set_current_harmonic(slot, &this->harmonics[i][slot][1]);
+      }
+    }
+  }
+
+  // One main loop iteration after `us` of idle time
+  void step(uint32_t us, bool dsp = true) {
+    ade7880_sim::now_us += us;
+    this->sim.advance(dsp ? us : 0);
+    run_scheduler();
+    this->ade.loop();
+  }
+
+  // One main loop iteration at the ESPHome pace: every 16 ms, or back to back with a
+  // HighFrequencyLoopRequester and only the other components' loops in between
+  void run_loop() {
+    this->step(esphome::HighFrequencyLoopRequester::is_high_frequency() ? 20 : 16000);
+  }
+
+  bool init() {
+    this->ade.setup();
+    for(int ms=0; ms<10000 && !this->ade.ready(); ms++) {
+      this->step(1000);
+    }
+    if(!this->ade.ready()) {
+      failures++;
+    }
+    return this->ade.ready();
+  }
+
+  // Run update() to completion with the DSP paused, returns the number of loop() slices
+  uint32_t publish() {
+    uint32_t slices = 0;
+    this->ade.update();
+    while(this->ade.publishing()) {
+      this->step(1000, false);
+      slices++;
+    }
+    return slices;
+  }
+};
+
+static BusStats diff(const BusStats &a, const BusStats &b) {
+  BusStats d;
+  d.transactions = a.transactions - b.transactions;
+  d.bytes = a.bytes - b.bytes;
+  d.bus_us = a.bus_us - b.bus_us;
+  return d;
+}
+
+// Expected transfers per update(), bytes per update(), transfers and bytes per LENERGY
+// and transfers of the initialization, indexed by verify mode
+static const double EXPECTED_TRAFFIC[3][5] = {
+    {24, 124, 13.0, 53.0, 140},
+    {14, 97, 11.0, 50.0, 132},
+    {8, 80, 5.0, 31.0, 132},
+};
+
+static void run(const char *name, ADE7880VerifyMode verify_mode) {
+  ade7880_sim::now_us = 0;
+  Fixture f(verify_mode);
+
+  bool ready = f.init();
+  BusStats init = f.sim.stats;
+  if(!ready) {
+    printf("%-13s initialization failed\n", name);
+    return;
+  }
+
+  // LENERGY servicing only
+  BusStats start = f.sim.stats;
+  uint32_t interrupts = 0;
+  for(int ms=0; ms<10000; ms++) {
+    ade7880_sim::now_us += 1000;
+    f.sim.advance(1000);
+    interrupts += f.ade.irq_pending();
+    f.ade.loop();
+  }
+  BusStats lenergy = diff(f.sim.stats, start);
+
+  // One update() with the DSP paused so no interrupt interleaves
+  start = f.sim.stats;
+  uint32_t slices = f.publish();
+  BusStats update = diff(f.sim.stats, start);
+
+  printf("%-13s %6u %7u %9.2f | %6.1f %7.1f %9.2f | %6u %6u %8.2f\n", name, update.transactions, update.bytes,
+         update.bus_us / 1000.0, (double)lenergy.transactions / interrupts, (double)lenergy.bytes / interrupts,
+         lenergy.bus_us / 1000.0 / interrupts, init.transactions, slices, f.slice_duration.state);
+
+  const double *expected = EXPECTED_TRAFFIC[verify_mode];
+  expect(name, "update xfers", update.transactions, expected[0]);
+  expect(name, "update bytes", update.bytes, expected[1]);
+  expect(name, "LENERGY xfers", (double)lenergy.transactions / interrupts, expected[2], 0.05);
+  expect(name, "LENERGY bytes", (double)lenergy.bytes / interrupts, expected[3], 0.05);
+  expect(name, "init xfers", init.transactions, expected[4]);
+  // Decoded against the simulated loads, within the register resolution
+  static const float POWER[3] = {1500.0f, 230.0f, 15.0f};
+  for(int i=0; i<3; i++) {
+    float current = POWER[i] / 230.0f / 0.95f;
+    expect(name, "voltage", f.sensors[i][0].state, 230.0f, 0.01);
+    expect(name, "current", f.sensors[i][1].state, current, 0.001);
+    expect(name, "active power", f.sensors[i][2].state, POWER[i], 0.1);
+    expect(name, "apparent power", f.sensors[i][3].state, 230.0f * current, 0.1);
+    expect(name, "power factor", f.sensors[i][5].state, 0.95, 0.001);
+    expect(name, "frequency", f.sensors[i][6].state, 50.0, 0.01);
+  }
+}
+
+// Energy counted over 10 minutes at 1500 W while loop() stalls for 2.5 s every 10 s and
+// update() runs every 60 s, the window is accurate to about one line cycle period. Energy
+// path transfers are those of interrupt servicing and of update() itself, the measurement
+// blocks read from loop() are not counted.
+static void run_energy(const char *name, ADE7880EnergyMode energy_mode) {
+  ade7880_sim::now_us = 0;
+  Fixture f(VERIFY_PER_BATCH, energy_mode);
+  if(!f.init()) {
+    printf("%-13s initialization failed\n", name);
+    return;
+  }
+  for(int ms=0; ms<5000; ms++) {
+    f.step(1000);
+  }
+  f.publish();
+  float start = f.sensors[0][7].state;
+
+  uint32_t energy_xfers = 0;
+  for(uint32_t ms=0; ms<600000; ms++) {
+    if(ms % 60000 == 59999) {
+      uint32_t before = f.sim.stats.transactions;
+      f.ade.update();
+      energy_xfers += f.sim.stats.transactions - before;
+    }
+    if(ms % 10000 < 5000 || ms % 10000 >= 7500) {
+      ade7880_sim::now_us += 1000;
+      f.sim.advance(1000);
+      run_scheduler();
+      bool irq = f.ade.irq_pending() && !f.ade.publishing();
+      uint32_t before = f.sim.stats.transactions;
+      f.ade.loop();
+      if(irq) {
+        energy_xfers += f.sim.stats.transactions - before;
+      }
+    }
+    else {
+      ade7880_sim::now_us += 1000;
+      f.sim.advance(1000);
+    }
+  }
+  f.publish();
+
+  float expected = 1500.0f * 600.0f / 3600.0f;
+  float measured = f.sensors[0][7].state - start;
+  printf("%-13s %9.2f %9.2f %7.2f %8u\n", name, expected, measured, (measured - expected) / expected * 100.0f,
+         energy_xfers * 6);
+  // Line cycle mode loses the cycles of the stalls, the other modes read running counters
+  expect(name, "energy Wh", measured, energy_mode == ENERGY_LINE_CYCLE ? 225.0 : 250.0, 0.05);
+}
+
+// One simulated day with energy persistence flushing early every 100 Wh, then a
+// shutdown and a fresh instance restoring the saved counters
+static void run_restore() {
+  ade7880_sim::now_us = 0;
+  float before;
+  uint32_t saves;
+  {
+    Fixture f(VERIFY_PER_BATCH);
+    f.ade.set_restore_energy(true);
+    f.ade.set_flush_energy_delta(100.0f);
+    if(!f.init()) {
+      printf("restore       initialization failed\n");
+      return;
+    }
+    saves = ade7880_sim::preference_saves;
+    for(uint32_t s=0; s<86400; s++) {
+      for(int i=0; i<100; i++) {
+        f.step(10000);
+      }
+      if(s % 60 == 59) {
+        f.publish();
+      }
+    }
+    saves = ade7880_sim::preference_saves - saves;
+    f.publish();
+    before = f.sensors[0][7].state;
+    f.ade.on_shutdown();
+  }
+
+  Fixture f(VERIFY_PER_BATCH);
+  f.ade.set_restore_energy(true);
+  if(!f.init()) {
+    printf("restore       initialization failed\n");
+    return;
+  }
+  f.publish();
+  printf("\n%-13s %9s %9s %9s\n", "restore", "saved Wh", "restored", "saves/d");
+  printf("%-13s %9.2f %9.2f %9u\n", "1 day", before, f.sensors[0][7].state, saves);
+  expect("restore", "restored Wh", f.sensors[0][7].state, before, 0.01);
+  expect("restore", "saves/d", saves, 144);
+}
+
+// One update() with THD and three harmonics on every phase: the sweep visits the
+// phases one HREADY at a time, each result set is a single burst. Counted are the
+// transfers of update() itself and of loop() calls servicing HREADY.
+static void run_harmonics() {
+  ade7880_sim::now_us = 0;
+  Fixture f(VERIFY_PER_BATCH);
+  f.enable_harmonics();
+  if(!f.init()) {
+    printf("harmonics     initialization failed\n");
+    return;
+  }
+  for(int ms=0; ms<2000; ms++) {
+    f.step(1000);
+  }
+
+  uint64_t begin = ade7880_sim::now_us;
+  BusStats start = f.sim.stats;
+  f.ade.update();
+  BusStats sweep = diff(f.sim.stats, start);
+  uint32_t published = f.thd[2][1].publish_count;
+  for(int ms=0; ms<5000 && f.thd[2][1].publish_count == published; ms++) {
+    ade7880_sim::now_us += 1000;
+    f.sim.advance(1000);
+    run_scheduler();
+    bool hready = f.ade.irq_pending() && (f.sim.get(ADE7880_STATUS0) & STATUS0_HREADY);
+    start = f.sim.stats;
+    f.ade.loop();
+    if(hready) {
+      BusStats d = diff(f.sim.stats, start);
+      sweep.transactions += d.transactions;
+      sweep.bytes += d.bytes;
+    }
+  }
+  double sweep_ms = (ade7880_sim::now_us - begin) / 1000.0;
+
+  printf("\n%-13s %6s %7s %9s %9s %9s %9s\n", "harmonics", "xfers", "bytes", "sweep ms", "VTHD %", "ITHD %",
+         "I3 %");
+  printf("%-13s %6u %7u %9.0f %9.2f %9.2f %9.2f\n", "3 phases", sweep.transactions, sweep.bytes, sweep_ms,
+         f.thd[0][0].state, f.thd[0][1].state, f.harmonics[0][0][1].state);
+  expect("harmonics", "xfers", sweep.transactions, 44);
+  expect("harmonics", "bytes", sweep.bytes, 488);
+  expect("harmonics", "VTHD", f.thd[0][0].state, 3.0, 0.01);
+  expect("harmonics", "ITHD", f.thd[0][1].state, 30.0, 0.01);
+  expect("harmonics", "I3", f.harmonics[0][0][1].state, 21.04, 0.01);
+}
+
+// Fundamental quantities on every phase and reactive energy read in the xWATTHR burst over
+// 10 minutes with update() every 10 s. Counted are the transfers of LENERGY servicing.
+static void run_fundamental() {
+  ade7880_sim::now_us = 0;
+  Fixture f(VERIFY_PER_BATCH);
+  f.enable_fundamental();
+  if(!f.init()) {
+    printf("fundamental   initialization failed\n");
+    return;
+  }
+  for(int ms=0; ms<5000; ms++) {
+    f.step(1000);
+  }
+  f.publish();
+  float start = f.fundamental[0][6].state;
+
+  uint32_t interrupts = 0;
+  BusStats lenergy;
+  for(uint32_t ms=0; ms<600000; ms++) {
+    if(ms % 10000 == 9999) {
+      f.ade.update();
+    }
+    ade7880_sim::now_us += 1000;
+    f.sim.advance(1000);
+    run_scheduler();
+    bool irq = f.ade.irq_pending() && (f.sim.get(ADE7880_STATUS0) & STATUS0_LENERGY);
+    BusStats before = f.sim.stats;
+    f.ade.loop();
+    if(irq) {
+      BusStats d = diff(f.sim.stats, before);
+      lenergy.bytes += d.bytes;
+      interrupts++;
+    }
+  }
+
+  float expected = f.fundamental[0][0].state * 600.0f / 3600.0f;
+  float measured = f.fundamental[0][6].state - start;
+  printf("\n%-13s %9s %9s %9s %9s %9s %9s\n", "fundamental", "var", "FPF", "VARh exp", "VARh", "error %",
+         "B/LENERGY");
+  printf("%-13s %9.2f %9.3f %9.2f %9.2f %9.2f %9.1f\n", "phase A", f.fundamental[0][0].state,
+         f.fundamental[0][5].state, expected, measured, (measured - expected) / expected * 100.0f,
+         (double)lenergy.bytes / interrupts);
+  expect("fundamental", "var", f.fundamental[0][0].state, 493.02, 0.01);
+  expect("fundamental", "FPF", f.fundamental[0][5].state, 0.95, 0.001);
+  expect("fundamental", "VARh error", std::fabs(measured - expected) / expected, 0.0, 0.005);
+}
+
+// A 100 ms sag to 150 V on phase B and a 20 ms 40 A inrush on phase A, with the IRQ1
+// event path. Latency is from the start of the disturbance to the published counter.
+static void run_events() {
+  ade7880_sim::now_us = 0;
+  Fixture f(VERIFY_PER_BATCH);
+  f.enable_events();
+  if(!f.init()) {
+    printf("events        initialization failed\n");
+    return;
+  }
+  for(int ms=0; ms<2000; ms++) {
+    f.step(1000);
+  }
+
+  // Only IRQ1 servicing counts, LENERGY keeps running in the background
+  uint32_t xfers = 0;
+  auto run = [&](uint32_t ms) {
+    for(uint32_t i=0; i<ms; i++) {
+      ade7880_sim::now_us += 1000;
+      f.sim.advance(1000);
+      run_scheduler();
+      bool irq1 = f.sim.irq1.asserted;
+      uint32_t before = f.sim.stats.transactions;
+      f.ade.loop();
+      if(irq1) {
+        xfers += f.sim.stats.transactions - before;
+      }
+    }
+  };
+  run(1000);
+  uint32_t idle = xfers;
+
+  ade7880_sim::PhaseLoad nominal{230.0f, 1.0f, 219.0f};
+  ade7880_sim::PhaseLoad load = nominal;
+  f.sim.set_load(1, nominal);
+  run(100);
+  load.voltage = 150.0f;
+  f.sim.set_load(1, load);
+  uint64_t begin = ade7880_sim::now_us;
+  uint32_t sag_latency = 0;
+  for(int ms=0; ms<100; ms++) {
+    run(1);
+    if(!sag_latency && f.events[1][0].state == 1.0f) {
+      sag_latency = (ade7880_sim::now_us - begin) / 1000;
+    }
+  }
+  f.sim.set_load(1, nominal);
+  run(100);
+  std::string sag_end = f.event.state;
+
+  load = nominal;
+  load.current = 40.0f;
+  f.sim.set_load(0, load);
+  begin = ade7880_sim::now_us;
+  uint32_t oi_latency = 0;
+  for(int ms=0; ms<20; ms++) {
+    run(1);
+    if(!oi_latency && f.events[0][2].state > 0.0f) {
+      oi_latency = (ade7880_sim::now_us - begin) / 1000;
+    }
+  }
+  f.sim.set_load(0, nominal);
+  run(100);
+
+  printf("\n%-13s %6s %6s %6s %9s %9s  %s\n", "events", "idle", "xfers", "OI", "sag ms", "OI ms", "last sag event");
+  printf("%-13s %6u %6u %6.0f %9u %9u  %s\n", "B sag, A OI", idle, xfers - idle, f.events[0][2].state, sag_latency,
+         oi_latency, sag_end.c_str());
+}
+
+// Phase C drops out for 500 ms with a 100 ms zero-crossing timeout, then phases B and C are
+// swapped for 3 s with updates every second. Transfers are those of IRQ1 servicing and of
+// update() itself.
+static void run_zero_crossing() {
+  ade7880_sim::now_us = 0;
+  Fixture f(VERIFY_PER_BATCH);
+  f.enable_zero_crossing();
+  if(!f.init()) {
+    printf("zero crossing initialization failed\n");
+    return;
+  }
+  for(int ms=0; ms<2000; ms++) {
+    f.step(1000);
+  }
+  // Both kinds of angles, one per update
+  f.publish();
+  f.step(1000);
+  f.publish();
+
+  uint32_t xfers = 0;
+  auto run = [&](uint32_t ms) {
+    for(uint32_t i=0; i<ms; i++) {
+      ade7880_sim::now_us += 1000;
+      f.sim.advance(1000);
+      run_scheduler();
+      bool irq1 = f.sim.irq1.asserted;
+      uint32_t before = f.sim.stats.transactions;
+      f.ade.loop();
+      if(irq1) {
+        xfers += f.sim.stats.transactions - before;
+      }
+    }
+  };
+  run(1000);
+  uint32_t idle = xfers;
+
+  ade7880_sim::PhaseLoad nominal{230.0f, 15.0f / 230.0f / 0.95f, 15.0f};
+  ade7880_sim::PhaseLoad load = nominal;
+  load.voltage = 0.0f;
+  f.sim.set_load(2, load);
+  uint64_t begin = ade7880_sim::now_us;
+  uint32_t lost_latency = 0;
+  for(int ms=0; ms<500; ms++) {
+    run(1);
+    if(!lost_latency && f.phase_loss[2].state) {
+      lost_latency = (ade7880_sim::now_us - begin) / 1000;
+    }
+  }
+  f.sim.set_load(2, nominal);
+  begin = ade7880_sim::now_us;
+  uint32_t restored_latency = 0;
+  for(int ms=0; ms<100; ms++) {
+    run(1);
+    if(!restored_latency && !f.phase_loss[2].state) {
+      restored_latency = (ade7880_sim::now_us - begin) / 1000;
+    }
+  }
+  uint32_t loss_xfers = xfers - idle;
+
+  f.sim.set_reverse_sequence(true);
+  xfers = 0;
+  for(int s=0; s<3; s++) {
+    run(1000);
+    uint32_t before = f.sim.stats.transactions;
+    f.ade.update();
+    xfers += f.sim.stats.transactions - before;
+  }
+  bool reversed = f.sequence_error.state;
+  uint32_t seq_xfers = xfers;
+  f.sim.set_reverse_sequence(false);
+  run(1000);
+  f.ade.update();
+  run(1000);
+  f.ade.update();
+
+  printf("\n%-13s %6s %6s %8s %8s %9s %7s %7s\n", "zero crossing", "idle", "xfers", "lost ms", "back ms", "seq xfers",
+         "A V-I", "B V-V");
+  printf("%-13s %6u %6u %8u %8u %9u %7.1f %7.1f  sequence %s, %s\n", "C lost 500ms", idle, loss_xfers, lost_latency,
+         restored_latency, seq_xfers, f.angles[0][0].state, f.angles[1][1].state, reversed ? "error" : "ok",
+         f.sequence_error.state ? "stuck" : "cleared");
+}
+
+// Phase A turns from a 1500 W load into a 3000 W export 30.5 s into a 60 s window, which
+// also reverses the total. Reported are the detection latency and the energy booked to
+// each direction against the exact split, with and without the direction sensors.
+static void run_direction(const char *name, ADE7880EnergyMode energy_mode, bool direction) {
+  ade7880_sim::now_us = 0;
+  Fixture f(VERIFY_PER_BATCH, energy_mode);
+  if(direction) {
+    f.enable_direction();
+  }
+  if(!f.init()) {
+    printf("%-13s initialization failed\n", name);
+    return;
+  }
+  for(int ms=0; ms<2000; ms++) {
+    f.step(1000);
+  }
+  f.ade.update();
+  while(f.ade.publishing()) {
+    f.step(1000);
+  }
+  float forward = f.sensors[0][7].state;
+  float reverse = f.sensors[0][8].state;
+
+  ade7880_sim::PhaseLoad export_load{230.0f, 3000.0f / 230.0f, -3000.0f};
+  uint32_t latency = 0;
+  for(int ms=0; ms<60000; ms++) {
+    if(ms == 30500) {
+      f.sim.set_load(0, export_load);
+    }
+    f.step(1000);
+    if(direction && ms >= 30500 && !latency && f.total_reverse_power.state) {
+      latency = ms - 30500 + 1;
+    }
+  }
+  f.ade.update();
+  forward = f.sensors[0][7].state - forward;
+  reverse = f.sensors[0][8].state - reverse;
+  float expected_forward = 1500.0f * 30.5f / 3600.0f;
+  float expected_reverse = 3000.0f * 29.5f / 3600.0f;
+  printf("%-13s %9s %9.3f %9.3f %9.3f %9.3f %9u\n", name, direction ? "yes" : "no", forward - expected_forward,
+         reverse - expected_reverse, forward, reverse, latency);
+  // Line cycle mode splits the energy of the cycle with the sign change at its end
+  double tolerance = energy_mode == ENERGY_LINE_CYCLE ? 0.25 : 0.01;
+  expect(name, "forward Wh", forward, expected_forward, tolerance);
+  expect(name, "reverse Wh", reverse, expected_reverse, tolerance);
+}
+
+// Phases B and C idle for 10 updates, then phase C draws 3 W for 10 s and gets its 15 W load
+// back. Reported are the bytes of one update(), the publishes of phase B current and phase C
+// power, and the energy of the 3 W (8.33 mWh).
+static void run_no_load(const char *name, float no_load_level) {
+  ade7880_sim::now_us = 0;
+  Fixture f(VERIFY_PER_BATCH);
+  f.ade.set_no_load_level(no_load_level);
+  ade7880_sim::PhaseLoad idle{230.0f, 0.0f, 0.0f};
+  f.sim.set_load(1, idle);
+  f.sim.set_load(2, idle);
+  if(!f.init()) {
+    printf("%-13s initialization failed\n", name);
+    return;
+  }
+  for(int ms=0; ms<2000; ms++) {
+    f.step(1000);
+  }
+  uint32_t bytes = 0;
+  for(int n=0; n<10; n++) {
+    BusStats start = f.sim.stats;
+    f.publish();
+    bytes += f.sim.stats.bytes - start.bytes;
+  }
+  uint32_t idle_publishes = f.sensors[1][1].publish_count;
+  // 3 W for 10 s, idle by the level but still metered
+  float energy = f.sensors[2][7].state;
+  f.sim.set_load(2, {230.0f, 3.0f / 230.0f / 0.95f, 3.0f});
+  for(int ms=0; ms<10000; ms++) {
+    f.step(1000);
+  }
+  f.publish();
+  energy = (f.sensors[2][7].state - energy) * 1000.0f;
+  f.sim.set_load(2, {230.0f, 15.0f / 230.0f / 0.95f, 15.0f});
+  f.step(1000);
+  f.publish();
+  printf("%-13s %9.1f %9u %9u %9.1f %9.2f\n", name, bytes / 10.0, idle_publishes, f.sensors[2][2].publish_count,
+         f.sensors[2][2].state, energy);
+}
+
+// 120 s of a 1 s active power need: everything at a 1 s update, or active power (and voltage)
+// with their own update_interval next to a 60 s update. Reported are the active power and
+// frequency publishes of phase A and the bus transfers and bytes per second.
+static void run_multi_rate(const char *name, uint32_t update_interval, uint32_t power_interval,
+                           uint32_t voltage_interval) {
+  ade7880_sim::now_us = 0;
+  Fixture f(VERIFY_PER_BATCH);
+  for(int i=0; i<3; i++) {
+    if(power_interval) {
+      f.ade.set_sensor_update_interval(&f.sensors[i][2], power_interval);
+    }
+    if(voltage_interval) {
+      f.ade.set_sensor_update_interval(&f.sensors[i][0], voltage_interval);
+    }
+  }
+  if(!f.init()) {
+    printf("%-13s initialization failed\n", name);
+    return;
+  }
+  BusStats start = f.sim.stats;
+  uint32_t power = f.sensors[0][2].publish_count;
+  uint32_t frequency = f.sensors[0][6].publish_count;
+  for(uint32_t ms=0; ms<120000; ms++) {
+    if(ms % update_interval == 0) {
+      f.ade.update();
+    }
+    f.step(1000);
+  }
+  BusStats d = diff(f.sim.stats, start);
+  printf("%-13s %9u %9u %9.2f %9.1f\n", name, f.sensors[0][2].publish_count - power,
+         f.sensors[0][6].publish_count - frequency, d.transactions / 120.0, d.bytes / 120.0);
+}
+
+// A 60 s update of phase A at 1500 W with a 3 s surge to 4000 W halfway. Reported are the
+// published snapshot, the window statistics of active power and the bus bytes per second.
+// Half full mode samples from a timer, the others with the LENERGY service.
+static void run_statistics(const char *name, bool statistics, ADE7880EnergyMode mode = ENERGY_LINE_CYCLE) {
+  ade7880_sim::now_us = 0;
+  Fixture f(VERIFY_PER_BATCH, mode);
+  sensor::Sensor stats[4];
+  if(statistics) {
+    f.channels[0].set_statistics(STATISTICS_ACTIVE_POWER, &stats[0], &stats[1], &stats[2], &stats[3]);
+  }
+  if(!f.init()) {
+    printf("%-13s initialization failed\n", name);
+    return;
+  }
+  for(int ms=0; ms<2000; ms++) {
+    f.step(1000);
+  }
+  f.publish();
+  BusStats start = f.sim.stats;
+  for(uint32_t ms=0; ms<60000; ms++) {
+    if(ms == 30000 || ms == 33000) {
+      float power = ms == 30000 ? 4000.0f : 1500.0f;
+      f.sim.set_load(0, {230.0f, power / 230.0f / 0.95f, power});
+    }
+    f.step(1000);
+  }
+  BusStats d = diff(f.sim.stats, start);
+  f.publish();
+  printf("%-13s %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n", name, f.sensors[0][2].state, stats[0].state,
+         stats[1].state, stats[2].state, stats[3].state, d.bytes / 60.0);
+  expect(name, "P", f.sensors[0][2].state, 1500.0, 0.1);
+  expect(name, "min", stats[0].state, statistics ? 1500.0 : NAN, 0.1);
+  expect(name, "max", stats[1].state, statistics ? 4000.0 : NAN, 0.1);
+  expect(name, "mean", stats[2].state, statistics ? 1625.0 : NAN, 0.1);
+  expect(name, "stddev", stats[3].state, statistics ? 544.9 : NAN, 0.1);
+  expect(name, "B/s", d.bytes / 60.0, !statistics ? 50.0 : mode == ENERGY_HALF_FULL ? 35.0 : 66.0, 0.05);
+}
+
+// A 100 mA leak against a 30 mA mismatch level for 3 s with updates every second. Transfers
+// are those of IRQ1 servicing and of update() itself.
+static void run_mismatch() {
+  ade7880_sim::now_us = 0;
+  Fixture f(VERIFY_PER_BATCH);
+  f.neutral.set_current_sum_sample(&f.current_sum_sample);
+  f.neutral.set_current_mismatch(&f.current_mismatch);
+  f.neutral.set_mismatch_level(0.03f);
+  f.ade.set_event_sensor(&f.event);
+  if(!f.init()) {
+    printf("mismatch      initialization failed\n");
+    return;
+  }
+  for(int ms=0; ms<2000; ms++) {
+    f.step(1000);
+  }
+  f.publish();
+
+  uint32_t xfers = 0;
+  auto run = [&](uint32_t ms) {
+    for(uint32_t i=0; i<ms; i++) {
+      ade7880_sim::now_us += 1000;
+      f.sim.advance(1000);
+      run_scheduler();
+      bool irq1 = f.sim.irq1.asserted;
+      uint32_t before = f.sim.stats.transactions;
+      f.ade.loop();
+      if(irq1) {
+        xfers += f.sim.stats.transactions - before;
+      }
+    }
+  };
+  run(1000);
+  uint32_t idle = xfers;
+
+  f.sim.set_leakage(0.1f);
+  uint32_t latency = 0;
+  for(int s=0; s<3; s++) {
+    for(int ms=0; ms<1000; ms++) {
+      run(1);
+      if(!latency && f.current_mismatch.state) {
+        latency = s * 1000 + ms + 1;
+      }
+    }
+    uint32_t before = f.sim.stats.transactions;
+    f.ade.update();
+    xfers += f.sim.stats.transactions - before;
+  }
+  bool tripped = f.current_mismatch.state;
+  uint32_t trip_xfers = xfers - idle;
+  f.sim.set_leakage(0.0f);
+  run(1000);
+  f.ade.update();
+  run(1000);
+  f.ade.update();
+
+  printf("\n%-13s %6s %9s %6s %9s  %s\n", "mismatch", "idle", "xfers/3s", "ms", "ISUM smp", "state");
+  printf("%-13s %6u %9u %6u %9.2f  %s, %s, %s\n", "100 mA leak", idle, trip_xfers, latency, f.current_sum_sample.state,
+         tripped ? "tripped" : "missed", f.current_mismatch.state ? "stuck" : "cleared", f.event.state.c_str());
+}
+
+// A 40 ms 40 A inrush on phase A between two 60 s updates. IPEAK/VPEAK track all phases, so
+// phase C with the lowest voltage never holds the voltage peak. Reported are the bus bytes
+// per second of the interval, including the interrupt services and the update.
+static void run_peaks() {
+  ade7880_sim::now_us = 0;
+  Fixture f(VERIFY_PER_BATCH);
+  f.enable_peaks();
+  f.sim.set_load(1, {232.0f, 1.05f, 230.0f});
+  if(!f.init()) {
+    printf("peaks         initialization failed\n");
+    return;
+  }
+  for(int ms=0; ms<2000; ms++) {
+    f.step(1000);
+  }
+  f.publish();
+
+  uint32_t bytes = f.sim.stats.bytes;
+  ade7880_sim::PhaseLoad nominal{230.0f, 1500.0f / 230.0f / 0.95f, 1500.0f};
+  for(uint32_t ms=0; ms<60000; ms++) {
+    if(ms == 20000 || ms == 20040) {
+      ade7880_sim::PhaseLoad load = nominal;
+      load.current = ms == 20000 ? 40.0f : nominal.current;
+      f.sim.set_load(0, load);
+    }
+    ade7880_sim::now_us += 1000;
+    f.sim.advance(1000);
+    run_scheduler();
+    f.ade.loop();
+  }
+  f.publish();
+  bytes = f.sim.stats.bytes - bytes;
+
+  printf("\n%-13s %9s %9s %9s %9s %9s\n", "peaks", "A peak A", "A rms A", "B peak V", "C peak V", "B/s");
+  printf("%-13s %9.2f %9.2f %9.1f %9.1f %9.1f\n", "40 A inrush", f.peaks[0][0].state, f.sensors[0][1].state,
+         f.peaks[1][1].state, f.peaks[2][1].state, bytes / 60.0);
+  // 40 A * sqrt(2), phase B at 232 V always holds the voltage peak
+  expect("peaks", "A peak A", f.peaks[0][0].state, 56.57, 0.01);
+  expect("peaks", "B peak V", f.peaks[1][1].state, 328.1, 0.1);
+  expect("peaks", "C peak V", f.peaks[2][1].state, NAN);
+}
+
+// 256 samples on demand with 50 us of other work between loop() calls. Reported are the
+// effective sample rate, the largest gap between samples and the rms of the captured
+// phase A voltage, the load has 3 % voltage THD.
+static void run_capture(const char *name, uint8_t channels) {
+  ade7880_sim::now_us = 0;
+  Fixture f(VERIFY_PER_BATCH);
+  f.ade.set_capture_samples(256);
+  f.ade.set_capture_channels(channels);
+  if(!f.init()) {
+    printf("%-13s initialization failed\n", name);
+    return;
+  }
+  for(int ms=0; ms<2000; ms++) {
+    f.step(1000);
+  }
+  f.publish();
+
+  BusStats before = f.sim.stats;
+  uint64_t start = ade7880_sim::now_us;
+  bool started = f.ade.start_capture();
+  while(started && f.ade.is_capturing() && ade7880_sim::now_us - start < 5000000) {
+    f.run_loop();
+  }
+  if(esphome::HighFrequencyLoopRequester::is_high_frequency()) {
+    printf("%-13s high frequency loop still requested\n", name);
+  }
+  BusStats d = diff(f.sim.stats, before);
+  uint16_t count = f.ade.get_capture_count();
+
+  uint32_t max_gap = 0;
+  double sum = 0.0;
+  for(uint16_t n=0; n<count; n++) {
+    if(n > 0 && f.ade.get_capture_time(n) - f.ade.get_capture_time(n - 1) > max_gap) {
+      max_gap = f.ade.get_capture_time(n) - f.ade.get_capture_time(n - 1);
+    }
+    // VA is the first voltage channel of every configuration below
+    float v = f.ade.get_capture_value(n, f.ade.get_capture_width() - 1);
+    sum += v * v;
+  }
+  uint32_t duration = count > 1 ? f.ade.get_capture_time(count - 1) : 0;
+  printf("%-13s %7u %9.1f %8.0f %8u %9.1f %9.1f\n", name, count, duration / 1000.0,
+         duration > 0 ? (count - 1) * 1e6 / duration : 0.0, max_gap, (double)d.bytes / count,
+         count > 0 ? std::sqrt(sum / count) : 0.0);
+}
+
+enum RecoveryFault {
+  FAULT_LOST_EDGE,
+  FAULT_POWER_ON_RESET,
+  FAULT_CORRUPTION,
+};
+
+// 30 s of line cycle metering of phase A with a fault at 5 s that trips the watchdog: an
+// IRQ0 edge lost on the wire, a brown-out of the chip, or a lost edge along with a
+// corrupted gain register. Reported are the resets, the time without metering and the
+// energy error.
+static void run_recovery(const char *name, RecoveryFault fault) {
+  ade7880_sim::now_us = 0;
+  Fixture f(VERIFY_PER_BATCH);
+  if(!f.init()) {
+    printf("%-13s initialization failed\n", name);
+    return;
+  }
+  for(int ms=0; ms<3000; ms++) {
+    f.step(1000);
+  }
+  f.publish();
+  float start = f.sensors[0][7].state;
+  uint32_t resets = f.sim.resets;
+
+  uint32_t outage = 0;
+  for(uint32_t ms=0; ms<30000; ms++) {
+    if(ms == 5000) {
+      if(fault == FAULT_POWER_ON_RESET) {
+        f.sim.power_on_reset();
+      }
+      else {
+        f.sim.irq0.drop_edges = true;
+      }
+      if(fault == FAULT_CORRUPTION) {
+        f.sim.set(ADE7880_AIGAIN, 0x12345);
+      }
+    }
+    if(ms == 6500) {
+      f.sim.irq0.drop_edges = false;
+    }
+    f.step(1000);
+    if(!f.ade.ready()) {
+      outage++;
+    }
+  }
+  f.publish();
+
+  float expected = 1500.0f * 30.0f / 3600.0f;
+  float measured = f.sensors[0][7].state - start;
+  printf("%-13s %7u %9u %9.3f %9.2f\n", name, f.sim.resets - resets, outage, measured,
+         (measured - expected) / expected * 100.0f);
+  // A lost edge resumes without a reset, the others re-initialize
+  expect(name, "resets", f.sim.resets - resets, fault == FAULT_LOST_EDGE ? 0 : 1);
+}
+
+// 60 s with the CHECKSUM monitor at a 2 s interval and a register corrupted at 10 s without
+// tripping the watchdog. Angles alternate each 10 s update and change COMPMODE, each state is
+// learned once. Reported are the integrity events, resets, the time until the register holds
+// its value again and the transfers per check.
+static void run_integrity(const char *name, uint16_t reg, uint32_t value) {
+  ade7880_sim::now_us = 0;
+  Fixture f(VERIFY_PER_BATCH);
+  sensor::Sensor events;
+  f.enable_zero_crossing();
+  f.enable_peaks();
+  f.ade.set_integrity_interval(2000);
+  f.ade.set_integrity_events_sensor(&events);
+  if(!f.init()) {
+    printf("%-13s initialization failed\n", name);
+    return;
+  }
+  uint32_t resets = f.sim.resets;
+  uint32_t original = reg ? f.sim.get(reg) : 0;
+  uint32_t repaired = 0;
+  uint64_t xfers = 0;
+  for(uint32_t ms=0; ms<60000; ms++) {
+    if(ms % 10000 == 0) {
+      f.ade.update();
+    }
+    if(reg && ms == 10000) {
+      f.sim.set(reg, value);
+    }
+    ade7880_sim::now_us += 1000;
+    f.sim.advance(1000);
+    BusStats before = f.sim.stats;
+    run_scheduler();
+    xfers += f.sim.stats.transactions - before.transactions;
+    f.ade.loop();
+    if(reg && ms >= 10000 && !repaired && f.sim.get(reg) == original) {
+      repaired = ms - 10000 + 1;
+    }
+  }
+  printf("%-13s %7.0f %7u %9u %11.1f\n", name, std::isnan(events.state) ? 0.0f : events.state,
+         f.sim.resets - resets, repaired, xfers / 30.0);
+  // AIGAIN is repaired in place, a CONFIG change survives the repair and re-initializes
+  expect(name, "events", std::isnan(events.state) ? 0.0 : events.state, !reg ? 0 : reg == ADE7880_CONFIG ? 2 : 1);
+  expect(name, "resets", f.sim.resets - resets, reg == ADE7880_CONFIG ? 1 : 0);
+  expect(name, "repaired", !reg || repaired > 0, 1);
+}
+
+// Spectrum of harmonics 2..25 on three phases, 24 steps with a budget of 3 steps
+// per 10 s update. Counted are all transfers except the measurement blocks.
+static void run_sweep() {
+  ade7880_sim::now_us = 0;
+  Fixture f(VERIFY_PER_BATCH);
+  std::vector<uint8_t> indexes;
+  for(uint8_t n=2; n<=25; n++) {
+    indexes.push_back(n);
+  }
+  f.enable_sweep(indexes, 3);
+  if(!f.init()) {
+    printf("sweep         initialization failed\n");
+    return;
+  }
+
+  // update() publishes the table measured so far and starts the next steps
+  uint32_t updates = 0;
+  uint32_t xfers = 0;
+  uint32_t bytes = 0;
+  const std::string &state = f.spectrum[2][1].state;
+  for(; updates<20; updates++) {
+    BusStats start = f.sim.stats;
+    f.ade.update();
+    if(!state.empty() && state.find("nan") == std::string::npos) {
+      break;
+    }
+    for(int ms=0; ms<10000; ms++) {
+      ade7880_sim::now_us += 1000;
+      f.sim.advance(1000);
+      run_scheduler();
+      bool publishing = f.ade.publishing();
+      BusStats before = f.sim.stats;
+      f.ade.loop();
+      if(publishing) {
+        // Measurement block slices are not part of the harmonic load
+        start.transactions += f.sim.stats.transactions - before.transactions;
+        start.bytes += f.sim.stats.bytes - before.bytes;
+      }
+    }
+    BusStats d = diff(f.sim.stats, start);
+    xfers += d.transactions;
+    bytes += d.bytes;
+  }
+
+  printf("\n%-13s %7s %9s %9s  %s\n", "sweep 2..25", "updates", "xfers/upd", "bytes/upd", "phase C current %");
+  printf("%-13s %7u %9u %9u  %.40s...\n", "3 steps", updates, xfers / updates, bytes / updates, state.c_str());
+}
+
+int main() {
+  printf("%-13s %22s | %24s | %23s\n", "", "per update()", "per LENERGY", "");
+  printf("%-13s %6s %7s %9s | %6s %7s %9s | %6s %6s %8s\n", "verify", "xfers", "bytes", "bus ms", "xfers", "bytes",
+         "bus ms", "init", "slices", "slice ms");
+  run("per_register", VERIFY_PER_REGISTER);
+  run("per_batch", VERIFY_PER_BATCH);
+  run("none", VERIFY_NONE);
+
+  printf("\n%-13s %9s %9s %7s %8s\n", "energy mode", "expected", "measured", "error %", "xfers/h");
+  run_energy("line_cycle", ENERGY_LINE_CYCLE);
+  run_energy("running_total", ENERGY_RUNNING_TOTAL);
+  run_energy("half_full", ENERGY_HALF_FULL);
+
+  run_restore();
+  run_harmonics();
+  run_fundamental();
+  run_events();
+  run_peaks();
+  run_zero_crossing();
+  run_mismatch();
+
+  printf("\n%-13s %9s %9s %9s %9s %9s %9s\n", "direction", "sensors", "fwd err", "rev err", "fwd Wh", "rev Wh",
+         "ms");
+  run_direction("line_cycle", ENERGY_LINE_CYCLE, false);
+  run_direction("line_cycle", ENERGY_LINE_CYCLE, true);
+  run_direction("running_total", ENERGY_RUNNING_TOTAL, false);
+  run_direction("running_total", ENERGY_RUNNING_TOTAL, true);
+  run_direction("half_full", ENERGY_HALF_FULL, false);
+  run_direction("half_full", ENERGY_HALF_FULL, true);
+
+  printf("\n%-13s %9s %9s %9s %9s %9s\n", "no load", "B/update", "B I pubs", "C P pubs", "C P W", "C 3W mWh");
+  run_no_load("disabled", 0.0f);
+  run_no_load("5 VA", 5.0f);
+
+  printf("\n%-13s %9s %9s %9s %9s %9s %9s\n", "statistics", "P W", "min W", "max W", "mean W", "stddev W",
+         "B/s");
+  run_statistics("disabled", false);
+  run_statistics("active power", true);
+  run_statistics("half_full", true, ENERGY_HALF_FULL);
+
+  printf("\n%-13s %9s %9s %9s %9s\n", "multi-rate", "A P pubs", "A f pubs", "xfers/s", "B/s");
+  run_multi_rate("all 1 s", 1000, 0, 0);
+  run_multi_rate("P 1 s", 60000, 1000, 0);
+  run_multi_rate("P 1 s, V 5 s", 60000, 1000, 5000);
+
+  printf("\n%-13s %7s %9s %8s %8s %9s %9s\n", "capture", "samples", "ms", "rate Hz", "gap us", "B/sample",
+         "VA rms V");
+  run_capture("VA", 1 << 4);
+  run_capture("IA VA", 1 << 0 | 1 << 4);
+  run_capture("all", 0x7F);
+
+  printf("\n%-13s %7s %9s %9s %9s\n", "recovery", "resets", "outage ms", "A Wh", "error %");
+  run_recovery("lost edge", FAULT_LOST_EDGE);
+  run_recovery("chip reset", FAULT_POWER_ON_RESET);
+  run_recovery("corruption", FAULT_CORRUPTION);
+
+  printf("\n%-13s %7s %7s %9s %11s\n", "integrity", "events", "resets", "repair ms", "xfers/check");
+  run_integrity("none", 0, 0);
+  run_integrity("AIGAIN", ADE7880_AIGAIN, 0x12345);
+  run_integrity("CONFIG", ADE7880_CONFIG, 0x0000);
+  run_sweep();
+
+  if(failures) {
+    fprintf(stderr, "%u checks failed\n", failures);
+    return 1;
+  }
+  return 0;
+}
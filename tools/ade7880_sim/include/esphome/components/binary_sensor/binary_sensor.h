@@ -0,0 +1,28 @@
+#pragma once
+
+// Host stand-in for esphome/components/binary_sensor/binary_sensor.h
+
+#include <cstdint>
+
+namespace esphome {
+namespace binary_sensor {
+
+class BinarySensor {
+ public:
+  // Like the real one, only state changes are published
+  void publish_state(bool state) {
+    if(this->has_state && this->state == state) {
+      return;
+    }
+    this->state = state;
+    this->has_state = true;
+    this->publish_count++;
+  }
+
+  bool state{false};
+  bool has_state{false};
+  uint32_t publish_count{0};
+};
+
+} // namespace binary_sensor
+} // namespace esphome
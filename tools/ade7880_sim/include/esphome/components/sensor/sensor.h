@@ -0,0 +1,23 @@
+#pragma once
+
+// Host stand-in for esphome/components/sensor/sensor.h
+
+#include <cmath>
+#include <cstdint>
+
+namespace esphome {
+namespace sensor {
+
+class Sensor {
+ public:
+  void publish_state(float state) {
+    this->state = state;
+    this->publish_count++;
+  }
+
+  float state{NAN};
+  uint32_t publish_count{0};
+};
+
+} // namespace sensor
+} // namespace esphome
@@ -0,0 +1,46 @@
+#pragma once
+
+// Host stand-in for esphome/core/hal.h, time is driven by the simulator
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+
+#define IRAM_ATTR
+#define HOT
+
+namespace esphome {
+
+uint32_t millis();
+uint32_t micros();
+
+namespace gpio {
+enum Flags : uint8_t {
+  FLAG_NONE = 0x00,
+  FLAG_INPUT = 0x01,
+  FLAG_OUTPUT = 0x02,
+};
+
+enum InterruptType : uint8_t {
+  INTERRUPT_RISING_EDGE = 1,
+  INTERRUPT_FALLING_EDGE = 2,
+  INTERRUPT_ANY_EDGE = 3,
+};
+} // namespace gpio
+
+class InternalGPIOPin {
+ public:
+  virtual ~InternalGPIOPin() = default;
+  virtual void setup() {}
+  virtual void pin_mode(gpio::Flags flags) {}
+  virtual bool digital_read() { return false; }
+  virtual void digital_write(bool value) {}
+
+  template<typename T> void attach_interrupt(void (*func)(T *), T *arg, gpio::InterruptType type) const {
+    this->attach_interrupt(reinterpret_cast<void (*)(void *)>(func), arg, type);
+  }
+  virtual void attach_interrupt(void (*func)(void *), void *arg, gpio::InterruptType type) const {}
+};
+
+} // namespace esphome
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace esphome {
+
+// FNV-1 hash as used by ESPHome for preference keys
+inline uint32_t fnv1_hash(const std::string &str) {
+  uint32_t hash = 2166136261UL;
+  for(char c : str) {
+    hash *= 16777619UL;
+    hash ^= (uint8_t)c;
+  }
+  return hash;
+}
+
+// Requests loop() back to back instead of every loop_interval while started
+class HighFrequencyLoopRequester {
+ public:
+  void start() {
+    if(this->started_) {
+      return;
+    }
+    num_requests++;
+    this->started_ = true;
+  }
+  void stop() {
+    if(!this->started_) {
+      return;
+    }
+    num_requests--;
+    this->started_ = false;
+  }
+  static bool is_high_frequency() { return num_requests > 0; }
+
+ protected:
+  bool started_{false};
+  static inline uint32_t num_requests = 0;
+};
+
+} // namespace esphome
@@ -0,0 +1,18 @@
+#pragma once
+
+// Host stand-in for esphome/core/log.h, only errors and warnings are printed
+
+#include <cstdio>
+
+#define ESP_LOGE(tag, ...) (fprintf(stderr, "[E][%s] ", tag), fprintf(stderr, __VA_ARGS__), fputc('\n', stderr))
+#define ESP_LOGW(tag, ...) (fprintf(stderr, "[W][%s] ", tag), fprintf(stderr, __VA_ARGS__), fputc('\n', stderr))
+#define ESP_LOGI(tag, ...) ((void) 0)
+#define ESP_LOGD(tag, ...) ((void) 0)
+#define ESP_LOGV(tag, ...) ((void) 0)
+#define ESP_LOGCONFIG(tag, ...) ((void) 0)
+
+#define LOG_PIN(prefix, pin) ((void) (pin))
+#define LOG_SENSOR(prefix, type, obj) ((void) (obj))
+#define LOG_I2C_DEVICE(obj) ((void) (obj))
+#define LOG_TEXT_SENSOR(prefix, type, obj) ((void) (obj))
+#define LOG_BINARY_SENSOR(prefix, type, obj) ((void) (obj))
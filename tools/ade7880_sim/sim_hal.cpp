@@ -0,0 +1,132 @@
+#include <cstring>
+#include <map>
+#include <vector>
+
+#include "esphome/core/component.h"
+#include "esphome/core/preferences.h"
+
+#include "sim_hal.h"
+
+namespace esphome {
+
+namespace setup_priority {
+const float DATA = 600.0f;
+} // namespace setup_priority
+
+struct ScheduledItem {
+  Component *component;
+  std::string name;
+  uint32_t next;
+  uint32_t interval;  // 0 for timeouts
+  std::function<void()> f;
+};
+
+static std::vector<ScheduledItem> scheduled;  // NOLINT
+
+uint32_t millis() { return (uint32_t)(ade7880_sim::now_us / 1000); }
+uint32_t micros() { return (uint32_t)ade7880_sim::now_us; }
+
+static bool cancel(Component *component, const std::string &name) {
+  for(auto it = scheduled.begin(); it != scheduled.end(); ++it) {
+    if(it->component == component && it->name == name) {
+      scheduled.erase(it);
+      return true;
+    }
+  }
+  return false;
+}
+
+Component::~Component() {
+  for(size_t i=0; i<scheduled.size();) {
+    if(scheduled[i].component == this) {
+      scheduled.erase(scheduled.begin() + i);
+    }
+    else {
+      i++;
+    }
+  }
+}
+
+void Component::set_timeout(const std::string &name, uint32_t timeout, std::function<void()> &&f) {
+  cancel(this, name);
+  scheduled.push_back({this, name, millis() + timeout, 0, std::move(f)});
+}
+
+bool Component::cancel_timeout(const std::string &name) { return cancel(this, name); }
+
+void Component::set_interval(const std::string &name, uint32_t interval, std::function<void()> &&f) {
+  cancel(this, name);
+  scheduled.push_back({this, name, millis() + interval, interval, std::move(f)});
+}
+
+bool Component::cancel_interval(const std::string &name) { return cancel(this, name); }
+
+class SimPreferenceBackend : public ESPPreferenceBackend {
+ public:
+  explicit SimPreferenceBackend(std::vector<uint8_t> *data) : data_(data) {}
+
+  bool save(const uint8_t *data, size_t len) override {
+    ++ade7880_sim::preference_saves;
+    this->data_->assign(data, data + len);
+    return true;
+  }
+
+  bool load(uint8_t *data, size_t len) override {
+    if(this->data_->size() != len) {
+      return false;
+    }
+    memcpy(data, this->data_->data(), len);
+    return true;
+  }
+
+ protected:
+  std::vector<uint8_t> *data_;
+};
+
+class SimPreferences : public ESPPreferences {
+ public:
+  ESPPreferenceObject make_preference(size_t length, uint32_t type, bool in_flash) override {
+    // Backends are kept for the process lifetime so objects stay valid across fixtures
+    this->backends_.push_back(new SimPreferenceBackend(&this->data_[type]));
+    return ESPPreferenceObject(this->backends_.back());
+  }
+
+  bool sync() override {
+    ++ade7880_sim::preference_syncs;
+    return true;
+  }
+
+ protected:
+  std::map<uint32_t, std::vector<uint8_t>> data_;
+  std::vector<SimPreferenceBackend *> backends_;
+};
+
+static SimPreferences sim_preferences;  // NOLINT
+ESPPreferences *global_preferences = &sim_preferences;  // NOLINT
+
+void run_scheduler() {
+  uint32_t now = millis();
+  for(size_t i=0; i<scheduled.size();) {
+    if((int32_t)(now - scheduled[i].next) < 0) {
+      i++;
+      continue;
+    }
+    ScheduledItem item = scheduled[i];
+    if(item.interval) {
+      scheduled[i].next += item.interval;
+      i++;
+    }
+    else {
+      scheduled.erase(scheduled.begin() + i);
+    }
+    // The callback may reschedule itself
+    item.f();
+  }
+}
+
+} // namespace esphome
+
+namespace ade7880_sim {
+uint32_t preference_saves = 0;
+uint32_t preference_syncs = 0;
+} // namespace ade7880_sim
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <cstdint>
+
+namespace ade7880_sim {
+
+// Simulated time in microseconds, millis() and micros() follow it
+extern uint64_t now_us;
+
+// Number of preference saves and syncs since start, a sync stands for one flash commit
+extern uint32_t preference_saves;
+extern uint32_t preference_syncs;
+
+} // namespace ade7880_sim